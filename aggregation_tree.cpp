@@ -0,0 +1,54 @@
+#include "aggregation_tree.h"
+#include <limits>
+
+AggregationTree::AggregationTree(size_t capacity) : leaves(0) {
+    reset(capacity);
+}
+
+void AggregationTree::reset(size_t capacity) {
+    leaves = 1;
+    while (leaves < capacity) {
+        leaves <<= 1;
+    }
+    // Unused slots must never win a query
+    mins.assign(2 * leaves, std::numeric_limits<double>::infinity());
+    maxs.assign(2 * leaves, -std::numeric_limits<double>::infinity());
+}
+
+void AggregationTree::set(size_t slot, double value) {
+    size_t node = leaves + slot;
+    mins[node] = value;
+    maxs[node] = value;
+    
+    for (node >>= 1; node > 0; node >>= 1) {
+        double lo = mins[2 * node] < mins[2 * node + 1] ? mins[2 * node] : mins[2 * node + 1];
+        double hi = maxs[2 * node] > maxs[2 * node + 1] ? maxs[2 * node] : maxs[2 * node + 1];
+        if (lo == mins[node] && hi == maxs[node]) {
+            break; // Ancestors are unchanged too
+        }
+        mins[node] = lo;
+        maxs[node] = hi;
+    }
+}
+
+void AggregationTree::query(size_t begin, size_t end, double& min_value, double& max_value) const {
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -std::numeric_limits<double>::infinity();
+    
+    // Iterative bottom-up walk over [begin, end)
+    for (size_t l = begin + leaves, r = end + leaves; l < r; l >>= 1, r >>= 1) {
+        if (l & 1) {
+            if (mins[l] < lo) lo = mins[l];
+            if (maxs[l] > hi) hi = maxs[l];
+            ++l;
+        }
+        if (r & 1) {
+            --r;
+            if (mins[r] < lo) lo = mins[r];
+            if (maxs[r] > hi) hi = maxs[r];
+        }
+    }
+    
+    min_value = lo;
+    max_value = hi;
+}
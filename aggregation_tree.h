@@ -0,0 +1,32 @@
+#ifndef AGGREGATION_TREE_H
+#define AGGREGATION_TREE_H
+
+#include <vector>
+#include <cstddef>
+
+// Segment tree of min/max over the physical slots of a SampleRing. Writing
+// a slot is O(log n) and so is querying the extremes of any slot range,
+// which lets the renderer aggregate a whole time window per column without
+// touching every sample.
+class AggregationTree {
+private:
+    size_t leaves;             // Power of two >= capacity
+    std::vector<double> mins;  // Heap layout, node i has children 2i and 2i+1
+    std::vector<double> maxs;
+    
+public:
+    explicit AggregationTree(size_t capacity = 0);
+    
+    // Size the tree for capacity slots, discarding all values
+    void reset(size_t capacity);
+    
+    // Store value in a slot and update its ancestors
+    void set(size_t slot, double value);
+    
+    // Extremes of slots [begin, end); the range must not be empty
+    void query(size_t begin, size_t end, double& min_value, double& max_value) const;
+    
+    size_t capacity() const { return leaves; }
+};
+
+#endif // AGGREGATION_TREE_H
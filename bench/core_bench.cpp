@@ -0,0 +1,281 @@
+// Microbenchmarks for the main per-value and per-frame costs: parsing,
+// adding points in both window modes, rendering into a null sink, the
+// headless quantile sketch and the shared memory feed.
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "data_parser.h"
+#include "terminal_graph.h"
+#include "value_sketch.h"
+#include "shared_feed.h"
+#include "sample.h"
+
+static double nowSeconds() {
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(now.time_since_epoch()).count();
+}
+
+// A datagram of values_per_line random values with two decimals
+static std::string makeDatagram(size_t values_per_line, const char* prefix) {
+    std::ostringstream out;
+    for (size_t i = 0; i < values_per_line; ++i) {
+        if (i > 0) out << ' ';
+        out << prefix << std::fixed << std::setprecision(2) << std::rand() / (double)RAND_MAX * 1000.0;
+    }
+    return out.str();
+}
+
+static void benchParse() {
+    std::cout << "Parsing, ns per value" << std::endl;
+    std::cout << std::setw(24) << "datagram" << std::setw(14) << "parseData" << std::setw(14) << "parseInto" << std::endl;
+    
+    const size_t sizes[] = { 1, 10, 100 };
+    for (size_t values : sizes) {
+        for (int tagged = 0; tagged < 2; ++tagged) {
+            std::string datagram = makeDatagram(values, tagged ? "ch=" : "");
+            size_t iterations = 2000000 / values;
+            DataParser parser;
+            
+            double sink = 0;
+            double start = nowSeconds();
+            for (size_t i = 0; i < iterations; ++i) {
+                std::vector<double> parsed = parser.parseData(datagram);
+                sink += parsed.size();
+            }
+            double legacy = (nowSeconds() - start) * 1e9 / (iterations * values);
+            
+            std::vector<Sample> samples;
+            samples.reserve(values);
+            start = nowSeconds();
+            for (size_t i = 0; i < iterations; ++i) {
+                samples.clear();
+                sink += parser.parseInto(datagram.data(), datagram.size(), samples, 0);
+            }
+            double batch = (nowSeconds() - start) * 1e9 / (iterations * values);
+            if (sink == 0.5) std::cerr << sink; // Keep the loops from being optimised away
+            
+            std::ostringstream label;
+            label << values << (tagged ? " tagged" : " bare") << " values";
+            std::cout << std::setw(24) << label.str() << std::fixed << std::setprecision(1)
+                      << std::setw(14) << legacy << std::setw(14) << batch << std::endl;
+        }
+    }
+}
+
+// Fill a graph with points spaced step_ms apart that end at now
+static void fillGraph(TerminalGraph& graph, size_t points, long long step_ms, int channels) {
+    long long now = currentTimeNs();
+    for (size_t i = 0; i < points; ++i) {
+        long long timestamp = now - (long long)(points - i) * step_ms * 1000000;
+        double value = 50 + 40 * std::sin(i / 500.0) + std::rand() % 10;
+        graph.addDataPoint(value, (uint16_t)(i % channels), timestamp);
+    }
+}
+
+static void benchAddDataPoint() {
+    struct Case { int minutes; int width; long long step_ms; };
+    const Case cases[] = {
+        { 0, 80, 10 }, { 0, 300, 10 },
+        { 1, 80, 10 }, { 10, 80, 10 }, { 60, 80, 10 }, { 60, 80, 1 },
+    };
+    
+    std::cout << "addDataPoint, ns per point" << std::endl;
+    std::cout << std::setw(24) << "mode" << std::setw(14) << "retained" << std::setw(14) << "ns" << std::endl;
+    for (const Case& c : cases) {
+        TerminalGraph graph(c.width, 24, c.minutes);
+        size_t points = 2000000;
+        double start = nowSeconds();
+        fillGraph(graph, points, c.step_ms, 1);
+        double ns = (nowSeconds() - start) * 1e9 / points;
+        
+        std::ostringstream label;
+        if (c.minutes > 0) {
+            label << c.minutes << "m window, " << c.step_ms << "ms";
+        } else {
+            label << "width " << c.width;
+        }
+        std::cout << std::setw(24) << label.str() << std::setw(14) << graph.getDataPointCount()
+                  << std::setw(14) << std::fixed << std::setprecision(1) << ns << std::endl;
+    }
+}
+
+static void benchRender() {
+    struct Case { int minutes; int width; int height; int channels; size_t points; PlotStyle style; };
+    const Case cases[] = {
+        { 0, 80, 24, 1, 1000, PlotStyle::BLOCKS }, { 0, 250, 70, 1, 1000, PlotStyle::BLOCKS },
+        { 0, 250, 70, 4, 4000, PlotStyle::BLOCKS }, { 10, 80, 24, 1, 60000, PlotStyle::BLOCKS },
+        { 10, 250, 70, 1, 60000, PlotStyle::BLOCKS }, { 60, 250, 70, 1, 100000, PlotStyle::BLOCKS },
+        { 0, 250, 70, 1, 1000, PlotStyle::BRAILLE }, { 10, 250, 70, 1, 60000, PlotStyle::BRAILLE },
+        { 10, 250, 70, 1, 60000, PlotStyle::HEATMAP }, { 60, 250, 70, 1, 100000, PlotStyle::HEATMAP },
+    };
+    
+    int null_fd = open("/dev/null", O_WRONLY);
+    std::cout << "render() into /dev/null, one new point per frame" << std::endl;
+    std::cout << std::setw(24) << "mode" << std::setw(14) << "us/frame" << std::setw(14) << "bytes/frame" << std::endl;
+    for (const Case& c : cases) {
+        TerminalGraph graph(c.width, c.height, c.minutes);
+        graph.setOutputFd(null_fd);
+        graph.setPlotStyle(c.style);
+        fillGraph(graph, c.points, c.minutes > 0 ? c.minutes * 60000LL / c.points : 10, c.channels);
+        graph.render(); // The first frame paints everything
+        
+        const int frames = 500;
+        size_t bytes = 0;
+        double start = nowSeconds();
+        for (int i = 0; i < frames; ++i) {
+            graph.addDataPoint(50 + std::rand() % 40, (uint16_t)(i % c.channels));
+            graph.render();
+            bytes += graph.getLastFrameBytes();
+        }
+        double us = (nowSeconds() - start) * 1e6 / frames;
+        
+        std::ostringstream label;
+        label << c.width << "x" << c.height << " ";
+        if (c.minutes > 0) {
+            label << c.minutes << "m";
+        } else {
+            label << "latest";
+        }
+        label << " " << c.channels << "ch";
+        if (c.style == PlotStyle::BRAILLE) {
+            label << " braille";
+        } else if (c.style == PlotStyle::HEATMAP) {
+            label << " heat";
+        }
+        std::cout << std::setw(24) << label.str() << std::fixed << std::setprecision(1)
+                  << std::setw(14) << us << std::setw(14) << bytes / frames << std::endl;
+    }
+    close(null_fd);
+}
+
+static void benchZoom() {
+    // A day of points at 10 per second; past the 10 minute window only the
+    // rollups hold them
+    TerminalGraph graph(250, 70, 10);
+    int null_fd = open("/dev/null", O_WRONLY);
+    graph.setOutputFd(null_fd);
+    fillGraph(graph, 864000, 100, 1);
+    
+    const long long spans_s[] = { 10, 60, 600, 3600, 6 * 3600, 24 * 3600 };
+    std::cout << "render() of a zoomed view, 250x70, 24h of points" << std::endl;
+    std::cout << std::setw(24) << "span" << std::setw(14) << "us/frame" << std::endl;
+    for (long long span : spans_s) {
+        graph.resetView();
+        graph.zoom(span / 600.0);
+        graph.render();
+        
+        const int frames = 200;
+        double start = nowSeconds();
+        for (int i = 0; i < frames; ++i) {
+            graph.addDataPoint(50 + std::rand() % 40);
+            graph.render();
+        }
+        double us = (nowSeconds() - start) * 1e6 / frames;
+        std::cout << std::setw(23) << span << "s" << std::fixed << std::setprecision(1) << std::setw(14) << us
+                  << std::endl;
+    }
+    close(null_fd);
+}
+
+static void benchSketch() {
+    const size_t values = 10000000;
+    std::vector<double> inputs(values);
+    for (size_t i = 0; i < values; ++i) {
+        inputs[i] = 50 + 40 * std::sin(i / 500.0) + (std::rand() % 1000) / 100.0;
+    }
+    
+    ValueSketch sketch;
+    double start = nowSeconds();
+    for (double value : inputs) {
+        sketch.add(value);
+    }
+    double add_ns = (nowSeconds() - start) * 1e9 / values;
+    
+    // Merging is how a rolling window is reported, e.g. 60 one-second sketches
+    ValueSketch merged;
+    const int merges = 1000;
+    start = nowSeconds();
+    for (int i = 0; i < merges; ++i) {
+        merged.merge(sketch);
+    }
+    double merge_us = (nowSeconds() - start) * 1e6 / merges;
+    
+    std::cout << "headless sketch" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << std::setw(24) << "add, ns/value" << std::setw(14) << add_ns << std::endl
+              << std::setw(24) << "merge, us" << std::setw(14) << merge_us << std::endl
+              << std::setw(24) << "p99" << std::setw(14) << sketch.quantile(0.99) << std::endl;
+}
+
+static void benchFeed() {
+    const std::string name = "udp_graph_core_bench_" + std::to_string(getpid());
+    const size_t batch = 4096;
+    const size_t rounds = 1000;
+    std::vector<Sample> samples(batch);
+    for (size_t i = 0; i < batch; ++i) {
+        samples[i].timestamp_ns = (long long)i * 1000;
+        samples[i].value = std::rand() / (double)RAND_MAX;
+        samples[i].channel = ChannelRegistry::DEFAULT_CHANNEL;
+    }
+    
+    ChannelRegistry channels;
+    FeedPublisher publisher(name, &channels);
+    FeedViewer viewer(name);
+    std::vector<Sample> out;
+    out.reserve(batch);
+    
+    double publish_seconds = 0;
+    double view_seconds = 0;
+    for (size_t round = 0; round < rounds; ++round) {
+        double start = nowSeconds();
+        publisher.publish(samples);
+        double published = nowSeconds();
+        out.clear();
+        viewer.drain(out, batch);
+        publish_seconds += published - start;
+        view_seconds += nowSeconds() - published;
+    }
+    
+    // A viewer that stalls for two rings' worth loses one ring, never blocks
+    for (size_t i = 0; i < 2 * FEED_SLOTS / batch; ++i) {
+        publisher.publish(samples);
+    }
+    size_t caught_up = 0;
+    do {
+        out.clear();
+        caught_up += viewer.drain(out, batch);
+    } while (!out.empty());
+    shm_unlink(("/" + name).c_str());
+    
+    double values = (double)batch * rounds;
+    std::cout << "shared feed" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << std::setw(24) << "publish, ns/value" << std::setw(14) << publish_seconds * 1e9 / values << std::endl
+              << std::setw(24) << "view, ns/value" << std::setw(14) << view_seconds * 1e9 / values << std::endl
+              << std::setw(24) << "missed after stall" << std::setw(14) << viewer.getMissedCount() << std::endl
+              << std::setw(24) << "read after stall" << std::setw(14) << caught_up << std::endl;
+}
+
+int main() {
+    std::srand(42);
+    benchParse();
+    std::cout << std::endl;
+    benchAddDataPoint();
+    std::cout << std::endl;
+    benchRender();
+    std::cout << std::endl;
+    benchZoom();
+    std::cout << std::endl;
+    benchSketch();
+    std::cout << std::endl;
+    benchFeed();
+    return 0;
+}
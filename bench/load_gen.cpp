@@ -0,0 +1,314 @@
+// Loopback load generator: sends UDP datagrams at a configured rate, size
+// and value distribution to an in-process ingest pool, and drives the same
+// drain / addDataPoint / render loop as the monitor (rendering into
+// /dev/null). Reports end-to-end values/s, drops and per-stage latency.
+//
+// Each datagram carries its send time as a tagged value (t=<us since the
+// epoch>), so latency is measured from send() to the moment the value is
+// drained and to the moment the frame that contains it has been written.
+// Datagrams are numbered (@seq=N), so losses are also reported as the
+// receiver's sequence gaps next to the kernel's drop counter.
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/udp.h>
+#include "ingest_pool.h"
+#include "terminal_graph.h"
+#include "render_scheduler.h"
+
+namespace {
+    struct Options {
+        int port = 4395;
+        double seconds = 3;
+        double rate = 20000; // Datagrams per second, 0 = as fast as possible
+        int values = 10;     // Values per datagram
+        std::string distribution = "uniform";
+        int shards = 1;
+        int minutes = 1;
+        int fps = RenderScheduler::DEFAULT_MAX_FPS;
+        int receive_buffer = 0; // Bytes, 0 = system default
+        int segments = 1;       // Datagrams per send, > 1 uses UDP_SEGMENT and UDP_GRO
+    };
+    
+    std::atomic<bool> sending(true);
+    std::atomic<unsigned long long> sent_datagrams(0);
+    std::atomic<unsigned long long> sent_values(0);
+    
+    long long nowMicros() {
+        auto now = std::chrono::system_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+    }
+    
+    double nowSeconds() {
+        auto now = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(now.time_since_epoch()).count();
+    }
+    
+    void printUsage(const char* program_name) {
+        std::cout << "Usage: " << program_name << " [OPTIONS]\n"
+                  << "  -p PORT    Loopback port to use (default: 4395)\n"
+                  << "  -d SECONDS How long to send (default: 3)\n"
+                  << "  -r RATE    Datagrams per second, 0 for as fast as possible (default: 20000)\n"
+                  << "  -n VALUES  Values per datagram (default: 10)\n"
+                  << "  -D DIST    Value distribution: uniform, normal, sine or walk (default: uniform)\n"
+                  << "  -j N       Receive shards (default: 1)\n"
+                  << "  -m MINUTES Graph time window, 0 for the width-based mode (default: 1)\n"
+                  << "  -f FPS     Render rate (default: 30)\n"
+                  << "  -b BYTES   Socket receive buffer (default: the system's)\n"
+                  << "  -g N       Send N equal-sized datagrams per call (UDP_SEGMENT) and receive\n"
+                  << "             with UDP_GRO (default: 1, plain sends)\n";
+    }
+    
+    // Send the datagrams in train with one syscall: padded to the longest
+    // with spaces and handed to the kernel to segment. Returns true if sent.
+    bool sendTrain(int fd, const struct sockaddr_in& target, const std::vector<std::string>& train) {
+        size_t segment = 0;
+        for (const std::string& datagram : train) {
+            segment = std::max(segment, datagram.size());
+        }
+        std::string payload;
+        for (const std::string& datagram : train) {
+            payload += datagram;
+            payload.append(segment - datagram.size(), ' ');
+        }
+        
+        uint16_t segment_size = (uint16_t)segment;
+        char control[CMSG_SPACE(sizeof(segment_size))];
+        std::memset(control, 0, sizeof(control));
+        struct iovec iov = { &payload[0], payload.size() };
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_name = (void*)&target;
+        message.msg_namelen = sizeof(target);
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(segment_size));
+        std::memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+        return sendmsg(fd, &message, 0) > 0;
+    }
+    
+    void sendLoop(const Options& options) {
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        struct sockaddr_in target;
+        std::memset(&target, 0, sizeof(target));
+        target.sin_family = AF_INET;
+        target.sin_port = htons(options.port);
+        target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> uniform(0, 100);
+        std::normal_distribution<double> normal(50, 10);
+        double walk = 50;
+        unsigned long long sequence = 0;
+        
+        double start = nowSeconds();
+        std::string datagram;
+        std::vector<std::string> train;
+        while (sending.load(std::memory_order_relaxed)) {
+            if (options.rate > 0) {
+                // Catch up in bursts rather than sleeping per datagram
+                double due = start + sequence / options.rate;
+                double wait = due - nowSeconds();
+                if (wait > 0) {
+                    std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+                    continue;
+                }
+            }
+            
+            std::ostringstream out;
+            out << "@seq=" << sequence << " t=" << nowMicros();
+            for (int i = 0; i < options.values; ++i) {
+                double value;
+                if (options.distribution == "normal") {
+                    value = normal(rng);
+                } else if (options.distribution == "sine") {
+                    value = 50 + 40 * std::sin((sequence * options.values + i) / 1000.0);
+                } else if (options.distribution == "walk") {
+                    walk += uniform(rng) / 50 - 1;
+                    value = walk;
+                } else {
+                    value = uniform(rng);
+                }
+                out << ' ' << std::fixed << std::setprecision(3) << value;
+            }
+            datagram = out.str();
+            ++sequence;
+            
+            if (options.segments > 1) {
+                train.push_back(datagram);
+                if ((int)train.size() < options.segments) {
+                    continue;
+                }
+                if (sendTrain(fd, target, train)) {
+                    sent_datagrams.fetch_add(train.size(), std::memory_order_relaxed);
+                    sent_values.fetch_add(train.size() * options.values, std::memory_order_relaxed);
+                }
+                train.clear();
+            } else if (sendto(fd, datagram.data(), datagram.size(), 0, (struct sockaddr*)&target, sizeof(target)) > 0) {
+                sent_datagrams.fetch_add(1, std::memory_order_relaxed);
+                sent_values.fetch_add(options.values, std::memory_order_relaxed);
+            }
+        }
+        close(fd);
+    }
+    
+    // Percentiles of a set of latencies, in place
+    std::string percentiles(std::vector<double>& samples, const char* unit) {
+        if (samples.empty()) {
+            return "-";
+        }
+        std::sort(samples.begin(), samples.end());
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1)
+            << "p50 " << samples[(samples.size() - 1) * 50 / 100] << unit
+            << "  p99 " << samples[(samples.size() - 1) * 99 / 100] << unit
+            << "  max " << samples.back() << unit
+            << "  (n=" << samples.size() << ")";
+        return out.str();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:d:r:n:D:j:m:f:b:g:h")) != -1) {
+        switch (opt) {
+            case 'p': options.port = std::atoi(optarg); break;
+            case 'd': options.seconds = std::atof(optarg); break;
+            case 'r': options.rate = std::atof(optarg); break;
+            case 'n': options.values = std::max(1, std::atoi(optarg)); break;
+            case 'D': options.distribution = optarg; break;
+            case 'j': options.shards = std::max(1, std::atoi(optarg)); break;
+            case 'm': options.minutes = std::max(0, std::atoi(optarg)); break;
+            case 'f': options.fps = std::max(1, std::atoi(optarg)); break;
+            case 'b': options.receive_buffer = std::max(0, std::atoi(optarg)); break;
+            case 'g': options.segments = std::min(64, std::max(1, std::atoi(optarg))); break;
+            default:
+                printUsage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    
+    IngestPool ingest(options.port, options.shards, 1 << 16, OverflowPolicy::DROP_OLDEST, -1, std::string(),
+                      options.receive_buffer, options.segments > 1);
+    TerminalGraph graph(80, 24, options.minutes, &ingest.getChannels());
+    int null_fd = open("/dev/null", O_WRONLY);
+    graph.setOutputFd(null_fd);
+    RenderScheduler scheduler(options.fps);
+    
+    std::vector<Sample> samples;
+    std::vector<double> drain_latency_us;  // send() to drained by the UI thread
+    std::vector<double> apply_us;          // addDataPoint() for one drained batch
+    std::vector<double> render_us;         // render() per frame
+    std::vector<double> screen_latency_us; // send() to the frame being written
+    std::vector<long long> unrendered;     // Send times applied since the last frame
+    unsigned long long applied_values = 0;
+    
+    ingest.start();
+    std::thread sender(sendLoop, std::cref(options));
+    double start = nowSeconds();
+    double stop_sending = start + options.seconds;
+    double stop_draining = stop_sending + 0.5; // Let the queues empty
+    
+    while (nowSeconds() < stop_draining) {
+        ingest.checkFailures();
+        if (sending && nowSeconds() >= stop_sending) {
+            sending = false;
+        }
+        
+        while (true) {
+            samples.clear();
+            if (ingest.drain(samples) == 0) {
+                break;
+            }
+            long long drained_at = nowMicros();
+            double apply_start = nowSeconds();
+            for (const Sample& sample : samples) {
+                // Values are untagged, so anything on another channel is a send time
+                if (sample.channel != ChannelRegistry::DEFAULT_CHANNEL) {
+                    drain_latency_us.push_back(drained_at - sample.value);
+                    unrendered.push_back((long long)sample.value);
+                } else {
+                    graph.addDataPoint(sample.value, sample.channel, sample.timestamp_ns);
+                    ++applied_values;
+                }
+            }
+            apply_us.push_back((nowSeconds() - apply_start) * 1e6);
+            scheduler.markDirty();
+        }
+        
+        if (scheduler.shouldRender()) {
+            double render_start = nowSeconds();
+            graph.render();
+            render_us.push_back((nowSeconds() - render_start) * 1e6);
+            scheduler.frameRendered();
+            
+            long long shown_at = nowMicros();
+            for (long long sent_at : unrendered) {
+                screen_latency_us.push_back(shown_at - sent_at);
+            }
+            unrendered.clear();
+        }
+        
+        int timeout_ms = scheduler.millisUntilNextFrame();
+        if (timeout_ms < 0) {
+            timeout_ms = 1000 / scheduler.getMaxFps();
+        }
+        if (timeout_ms > 0) {
+            poll(nullptr, 0, timeout_ms);
+        }
+    }
+    sending = false;
+    sender.join();
+    ingest.stop();
+    close(null_fd);
+    
+    unsigned long long datagrams = sent_datagrams.load();
+    unsigned long long values = sent_values.load();
+    unsigned long long received = ingest.getDatagramCount();
+    double lost = values > 0 ? 100.0 * (values - std::min(values, applied_values)) / values : 0;
+    
+    std::cout << "Load: " << options.values << " " << options.distribution << " values per datagram, "
+              << (options.rate > 0 ? std::to_string((long long)options.rate) + " datagrams/s" : std::string("unpaced"))
+              << ", " << options.shards << " shard(s), "
+              << (options.segments > 1 ? std::to_string(options.segments) + " per send with GRO, " : std::string())
+              << (options.minutes > 0 ? std::to_string(options.minutes) + "m window" : std::string("width mode"))
+              << std::endl;
+    std::cout << std::fixed << std::setprecision(0)
+              << "Sent:      " << datagrams << " datagrams, " << values << " values ("
+              << values / options.seconds << " values/s)" << std::endl
+              << "Applied:   " << applied_values << " values (" << applied_values / options.seconds << " values/s)" << std::endl
+              << std::setprecision(2)
+              << "Dropped:   " << lost << "% (socket: " << datagrams - std::min(datagrams, received)
+              << " datagrams, queue: " << ingest.getDroppedCount() << " samples)" << std::endl;
+    LossCounts loss = ingest.getLossCounts();
+    std::cout << "Socket:    " << ingest.getReceiveBuffer() << " byte buffer, kernel dropped " << loss.kernel_drops
+              << ", sequence gaps " << loss.lost << " (" << loss.lossPercent() << "%), reordered "
+              << loss.reordered << ", duplicates " << loss.duplicates << std::endl;
+    std::cout << "Latency" << std::endl
+              << "  send -> drain   " << percentiles(drain_latency_us, "us") << std::endl
+              << "  apply batch     " << percentiles(apply_us, "us") << std::endl
+              << "  render          " << percentiles(render_us, "us") << std::endl
+              << "  send -> screen  " << percentiles(screen_latency_us, "us") << std::endl;
+    return 0;
+}
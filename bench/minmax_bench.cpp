@@ -0,0 +1,77 @@
+// Compares the per-sample cost of tracking window extremes with a full
+// rescan against the incremental MinMaxWindow as the window grows.
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include "sample_ring.h"
+#include "minmax_window.h"
+
+static double nowSeconds() {
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(now.time_since_epoch()).count();
+}
+
+// Per-sample cost of pushing into a full window and rescanning it
+static double benchRescan(size_t window, size_t samples, const std::vector<double>& input) {
+    SampleRing ring(window);
+    double sink = 0;
+    double start = nowSeconds();
+    for (size_t i = 0; i < samples; ++i) {
+        ring.push(input[i % input.size()], (long long)i);
+        double lo = ring.value(0), hi = lo;
+        for (size_t j = 1; j < ring.size(); ++j) {
+            double v = ring.value(j);
+            if (v < lo) lo = v;
+            if (v > hi) hi = v;
+        }
+        sink += hi - lo;
+    }
+    double elapsed = nowSeconds() - start;
+    if (sink == 0.5) std::cerr << sink; // Keep the loop from being optimised away
+    return elapsed * 1e9 / samples;
+}
+
+// Per-sample cost of pushing into a full window with incremental extremes
+static double benchIncremental(size_t window, size_t samples, const std::vector<double>& input) {
+    SampleRing ring(window);
+    MinMaxWindow extremes(window);
+    double sink = 0;
+    double start = nowSeconds();
+    for (size_t i = 0; i < samples; ++i) {
+        double value = input[i % input.size()];
+        ring.push(value, (long long)i);
+        extremes.push(value);
+        sink += extremes.max() - extremes.min();
+    }
+    double elapsed = nowSeconds() - start;
+    if (sink == 0.5) std::cerr << sink;
+    return elapsed * 1e9 / samples;
+}
+
+int main() {
+    std::vector<double> input(1 << 16);
+    std::srand(42);
+    for (size_t i = 0; i < input.size(); ++i) {
+        input[i] = std::rand() / (double)RAND_MAX * 100.0;
+    }
+    
+    const size_t windows[] = { 100, 1000, 10000, 100000, 1000000 };
+    
+    std::cout << "Window extremes, ns per sample" << std::endl;
+    std::cout << std::setw(10) << "window" << std::setw(14) << "rescan" << std::setw(14) << "incremental" << std::endl;
+    for (size_t w : windows) {
+        // Fill the window first, then measure steady state with a full window
+        size_t samples = w * 2 + 200000;
+        std::cout << std::setw(10) << w;
+        if (w <= 10000) {
+            std::cout << std::setw(14) << std::fixed << std::setprecision(1) << benchRescan(w, samples, input);
+        } else {
+            std::cout << std::setw(14) << "-"; // Too slow to be worth measuring
+        }
+        std::cout << std::setw(14) << std::fixed << std::setprecision(1) << benchIncremental(w, samples, input) << std::endl;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "channel_registry.h"
+#include <cstring>
+
+const uint16_t ChannelRegistry::DEFAULT_CHANNEL;
+const uint16_t ChannelRegistry::INVALID_CHANNEL;
+const size_t ChannelRegistry::MAX_CHANNELS;
+const size_t ChannelRegistry::MAX_NAME_LENGTH;
+const size_t ChannelRegistry::TABLE_SIZE;
+
+ChannelRegistry::ChannelRegistry() : count(1) {
+    // names[DEFAULT_CHANNEL] stays empty
+    for (size_t i = 0; i < TABLE_SIZE; ++i) {
+        slots[i].store(-1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t ChannelRegistry::hash(const char* name, size_t length) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int ChannelRegistry::find(const char* name, size_t length, size_t& index) const {
+    index = hash(name, length) & (TABLE_SIZE - 1);
+    for (;;) {
+        // Acquire pairs with the release in intern(), making the name visible
+        int16_t channel = slots[index].load(std::memory_order_acquire);
+        if (channel < 0) {
+            return -1;
+        }
+        const std::string& existing = names[channel];
+        if (existing.size() == length && memcmp(existing.data(), name, length) == 0) {
+            return channel;
+        }
+        index = (index + 1) & (TABLE_SIZE - 1);
+    }
+}
+
+uint16_t ChannelRegistry::intern(const char* name, size_t length) {
+    if (length == 0 || length > MAX_NAME_LENGTH) {
+        return INVALID_CHANNEL;
+    }
+    
+    // Fast path: known names are found without locking
+    size_t index;
+    int channel = find(name, length, index);
+    if (channel >= 0) {
+        return (uint16_t)channel;
+    }
+    
+    // Another thread may have registered the name since the lock-free probe
+    std::lock_guard<std::mutex> lock(insert_mutex);
+    channel = find(name, length, index);
+    if (channel >= 0) {
+        return (uint16_t)channel;
+    }
+    
+    size_t next = count.load(std::memory_order_relaxed);
+    if (next >= MAX_CHANNELS) {
+        return INVALID_CHANNEL;
+    }
+    
+    names[next].assign(name, length);
+    count.store(next + 1, std::memory_order_release);
+    slots[index].store((int16_t)next, std::memory_order_release);
+    return (uint16_t)next;
+}
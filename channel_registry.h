@@ -0,0 +1,50 @@
+#ifndef CHANNEL_REGISTRY_H
+#define CHANNEL_REGISTRY_H
+
+#include <string>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+// Interns channel names to small integer ids. Lookups hash the name bytes
+// in place, so resolving a known channel never allocates or locks; only the
+// first sighting of a name takes a lock and copies it.
+//
+// Any number of threads may intern and read names concurrently: a name is
+// fully stored before its id is published, and names never move once stored.
+class ChannelRegistry {
+public:
+    static const uint16_t DEFAULT_CHANNEL = 0; // Untagged values
+    static const uint16_t INVALID_CHANNEL = 0xFFFF;
+    static const size_t MAX_CHANNELS = 64;
+    static const size_t MAX_NAME_LENGTH = 31;
+    
+private:
+    // Power of two, at least twice MAX_CHANNELS to keep probe chains short
+    static const size_t TABLE_SIZE = 128;
+    
+    std::string names[MAX_CHANNELS];          // Indexed by channel id
+    std::atomic<size_t> count;                // Number of published channels
+    std::atomic<int16_t> slots[TABLE_SIZE];   // Open addressing table of channel ids, -1 = empty
+    std::mutex insert_mutex;                  // Serialises registration of new names
+    
+    static uint32_t hash(const char* name, size_t length);
+    
+    // Probe for name; returns the channel, or -1 with index at the free slot
+    int find(const char* name, size_t length, size_t& index) const;
+    
+public:
+    ChannelRegistry();
+    
+    // Return the id for name, registering it if new. Returns INVALID_CHANNEL
+    // if the name is empty, too long, or the registry is full.
+    uint16_t intern(const char* name, size_t length);
+    
+    // Name of a channel; the default channel has an empty name
+    const std::string& getName(uint16_t channel) const { return names[channel]; }
+    
+    size_t size() const { return count.load(std::memory_order_acquire); }
+};
+
+#endif // CHANNEL_REGISTRY_H
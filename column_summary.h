@@ -0,0 +1,45 @@
+#ifndef COLUMN_SUMMARY_H
+#define COLUMN_SUMMARY_H
+
+#include <cstddef>
+
+// Aggregate of the samples that fall into one screen column (M4: min, max,
+// first and last), filled in time order from one or more sources
+struct ColumnSummary {
+    size_t count;
+    double min_value;
+    double max_value;
+    double first;
+    double last;
+    
+    void reset() { count = 0; }
+    
+    // Fold in one sample that is newer than everything already folded in
+    void add(double value) {
+        if (count == 0) {
+            min_value = max_value = first = value;
+        } else {
+            if (value < min_value) min_value = value;
+            if (value > max_value) max_value = value;
+        }
+        last = value;
+        ++count;
+    }
+    
+    // Fold in a summary of samples newer than everything already folded in
+    void merge(const ColumnSummary& other) {
+        if (other.count == 0) {
+            return;
+        }
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        if (other.min_value < min_value) min_value = other.min_value;
+        if (other.max_value > max_value) max_value = other.max_value;
+        last = other.last;
+        count += other.count;
+    }
+};
+
+#endif // COLUMN_SUMMARY_H
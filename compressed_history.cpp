@@ -0,0 +1,319 @@
+#include "compressed_history.h"
+#include <cstring>
+#include <limits>
+
+namespace {
+    // Worst case for one sample: '1111' + 32 bit delta-of-delta, then
+    // '11' + 5 bit leading zeros + 6 bit length + 64 meaningful bits
+    const size_t MAX_SAMPLE_BITS = 4 + 32 + 2 + 5 + 6 + 64;
+    
+    inline uint64_t doubleBits(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    
+    inline double bitsDouble(uint64_t bits) {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    
+    // Column c covers [window_start + window_ms * c / columns, next boundary),
+    // matching how the ring's columns are split
+    inline long long columnStart(long long window_start, long long window_ms, int col, int columns) {
+        return window_start + window_ms * col / columns;
+    }
+    
+    int columnOf(long long timestamp, long long window_start, long long window_ms, int columns) {
+        long long offset = timestamp - window_start;
+        int col = offset >= window_ms ? columns - 1 : (int)(offset * columns / window_ms);
+        while (col + 1 < columns && timestamp >= columnStart(window_start, window_ms, col + 1, columns)) {
+            ++col;
+        }
+        while (col > 0 && timestamp < columnStart(window_start, window_ms, col, columns)) {
+            --col;
+        }
+        return col;
+    }
+}
+
+void CompressedHistory::Block::writeBits(uint64_t value, int bits) {
+    if (bits <= 0) {
+        return;
+    }
+    if (bits < 64) {
+        value &= (1ULL << bits) - 1;
+    }
+    
+    // Bits are packed most significant first
+    size_t word = bit_count / 64;
+    int free_bits = 64 - (int)(bit_count % 64);
+    if (bits <= free_bits) {
+        words[word] |= value << (free_bits - bits);
+    } else {
+        int spill = bits - free_bits;
+        words[word] |= value >> spill;
+        words[word + 1] |= value << (64 - spill);
+    }
+    bit_count += bits;
+}
+
+CompressedHistory::BlockReader::BlockReader(const Block& b)
+    : block(b), bit_position(0), remaining(b.summary.count), timestamp(b.first_timestamp),
+      delta(0), bits(doubleBits(b.summary.first)), leading(0), trailing(0) {
+}
+
+uint64_t CompressedHistory::BlockReader::readBits(int count) {
+    if (count <= 0) {
+        return 0;
+    }
+    
+    size_t word = bit_position / 64;
+    int used = (int)(bit_position % 64);
+    int available = 64 - used;
+    uint64_t result = (block.words[word] << used) >> (64 - count);
+    if (count > available) {
+        int spill = count - available;
+        result |= block.words[word + 1] >> (64 - spill);
+    }
+    bit_position += count;
+    return result;
+}
+
+bool CompressedHistory::BlockReader::next(long long& out_timestamp, double& out_value) {
+    if (remaining == 0) {
+        return false;
+    }
+    
+    // The first sample is stored uncompressed in the block header
+    if (remaining-- == block.summary.count) {
+        out_timestamp = timestamp;
+        out_value = block.summary.first;
+        return true;
+    }
+    
+    // Timestamp: delta-of-delta with a unary bucket prefix
+    long long dod;
+    if (readBits(1) == 0) {
+        dod = 0;
+    } else if (readBits(1) == 0) {
+        dod = (long long)readBits(7) - 63;
+    } else if (readBits(1) == 0) {
+        dod = (long long)readBits(9) - 255;
+    } else if (readBits(1) == 0) {
+        dod = (long long)readBits(12) - 2047;
+    } else {
+        dod = (int32_t)(uint32_t)readBits(32);
+    }
+    delta += dod;
+    timestamp += delta;
+    
+    // Value: XOR against the previous value
+    if (readBits(1) == 1) {
+        if (readBits(1) == 1) {
+            leading = (int)readBits(5);
+            int length = (int)readBits(6);
+            if (length == 0) {
+                length = 64;
+            }
+            trailing = 64 - leading - length;
+        }
+        int length = 64 - leading - trailing;
+        bits ^= readBits(length) << trailing;
+    }
+    
+    out_timestamp = timestamp;
+    out_value = bitsDouble(bits);
+    return true;
+}
+
+CompressedHistory::CompressedHistory(size_t limit)
+    : sample_count(0), byte_limit(limit), extremes_valid(true),
+      sealed_min(std::numeric_limits<double>::infinity()),
+      sealed_max(-std::numeric_limits<double>::infinity()) {
+}
+
+void CompressedHistory::setLimit(size_t bytes) {
+    byte_limit = bytes;
+    while (getBytes() > byte_limit && !blocks.empty()) {
+        dropOldestBlock();
+    }
+}
+
+void CompressedHistory::startBlock(long long timestamp, double value) {
+    // Fold the block being sealed into the cached extremes
+    if (!blocks.empty() && extremes_valid) {
+        const ColumnSummary& sealed = blocks.back().summary;
+        if (sealed.min_value < sealed_min) sealed_min = sealed.min_value;
+        if (sealed.max_value > sealed_max) sealed_max = sealed.max_value;
+    }
+    
+    blocks.emplace_back(); // Value-initialized: bitstream starts zeroed
+    Block& block = blocks.back();
+    block.first_timestamp = timestamp;
+    block.last_timestamp = timestamp;
+    block.summary.reset();
+    block.summary.add(value);
+    block.bit_count = 0;
+    block.previous_delta = 0;
+    block.previous_bits = doubleBits(value);
+    block.previous_leading = -1; // No XOR window yet
+    block.previous_trailing = 0;
+}
+
+bool CompressedHistory::appendToBlock(Block& block, long long timestamp, double value) {
+    if (BLOCK_WORDS * 64 - block.bit_count < MAX_SAMPLE_BITS) {
+        return false;
+    }
+    long long delta = timestamp - block.last_timestamp;
+    long long dod = delta - block.previous_delta;
+    if (dod < std::numeric_limits<int32_t>::min() || dod > std::numeric_limits<int32_t>::max()) {
+        return false;
+    }
+    
+    if (dod == 0) {
+        block.writeBits(0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        block.writeBits(0x2, 2);
+        block.writeBits((uint64_t)(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        block.writeBits(0x6, 3);
+        block.writeBits((uint64_t)(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        block.writeBits(0xE, 4);
+        block.writeBits((uint64_t)(dod + 2047), 12);
+    } else {
+        block.writeBits(0xF, 4);
+        block.writeBits((uint32_t)(int32_t)dod, 32);
+    }
+    
+    uint64_t bits = doubleBits(value);
+    uint64_t xored = bits ^ block.previous_bits;
+    if (xored == 0) {
+        block.writeBits(0, 1);
+    } else {
+        int leading = __builtin_clzll(xored);
+        int trailing = __builtin_ctzll(xored);
+        if (leading > 31) {
+            leading = 31; // Must fit in 5 bits
+        }
+        
+        if (block.previous_leading >= 0 && leading >= block.previous_leading &&
+            trailing >= block.previous_trailing) {
+            // Meaningful bits fit in the previous window
+            int length = 64 - block.previous_leading - block.previous_trailing;
+            block.writeBits(0x2, 2);
+            block.writeBits(xored >> block.previous_trailing, length);
+        } else {
+            int length = 64 - leading - trailing;
+            block.writeBits(0x3, 2);
+            block.writeBits((uint64_t)leading, 5);
+            block.writeBits((uint64_t)(length & 63), 6); // 64 is stored as 0
+            block.writeBits(xored >> trailing, length);
+            block.previous_leading = leading;
+            block.previous_trailing = trailing;
+        }
+    }
+    
+    block.previous_delta = delta;
+    block.previous_bits = bits;
+    block.last_timestamp = timestamp;
+    block.summary.add(value);
+    return true;
+}
+
+void CompressedHistory::append(long long timestamp, double value) {
+    if (byte_limit == 0) {
+        return;
+    }
+    if (blocks.empty() || !appendToBlock(blocks.back(), timestamp, value)) {
+        startBlock(timestamp, value);
+    }
+    ++sample_count;
+    
+    // Drop whole blocks, but never the one just written to
+    while (getBytes() > byte_limit && blocks.size() > 1) {
+        dropOldestBlock();
+    }
+}
+
+void CompressedHistory::dropOldestBlock() {
+    sample_count -= blocks.front().summary.count;
+    blocks.pop_front();
+    extremes_valid = false;
+}
+
+void CompressedHistory::expire(long long cutoff) {
+    while (!blocks.empty() && blocks.front().last_timestamp < cutoff) {
+        dropOldestBlock();
+    }
+}
+
+void CompressedHistory::clear() {
+    blocks.clear();
+    sample_count = 0;
+    extremes_valid = false;
+}
+
+void CompressedHistory::refreshExtremes() {
+    sealed_min = std::numeric_limits<double>::infinity();
+    sealed_max = -std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i + 1 < blocks.size(); ++i) {
+        const ColumnSummary& summary = blocks[i].summary;
+        if (summary.min_value < sealed_min) sealed_min = summary.min_value;
+        if (summary.max_value > sealed_max) sealed_max = summary.max_value;
+    }
+    extremes_valid = true;
+}
+
+bool CompressedHistory::getExtremes(double& min_value, double& max_value) {
+    if (blocks.empty()) {
+        return false;
+    }
+    if (!extremes_valid) {
+        refreshExtremes();
+    }
+    
+    const ColumnSummary& open = blocks.back().summary;
+    min_value = open.min_value < sealed_min ? open.min_value : sealed_min;
+    max_value = open.max_value > sealed_max ? open.max_value : sealed_max;
+    return true;
+}
+
+void CompressedHistory::summarize(long long window_start, long long window_ms,
+                                  ColumnSummary* columns, int column_count) const {
+    if (column_count <= 0 || window_ms <= 0) {
+        return;
+    }
+    
+    long long window_end = window_start + window_ms;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const Block& block = blocks[i];
+        if (block.last_timestamp < window_start) {
+            continue;
+        }
+        if (block.first_timestamp >= window_end) {
+            break;
+        }
+        
+        if (block.first_timestamp >= window_start && block.last_timestamp < window_end) {
+            int first_col = columnOf(block.first_timestamp, window_start, window_ms, column_count);
+            int last_col = columnOf(block.last_timestamp, window_start, window_ms, column_count);
+            if (first_col == last_col) {
+                columns[first_col].merge(block.summary);
+                continue;
+            }
+        }
+        
+        // The block straddles a column boundary or the window start
+        BlockReader reader(block);
+        long long timestamp;
+        double value;
+        while (reader.next(timestamp, value)) {
+            if (timestamp >= window_start && timestamp < window_end) {
+                columns[columnOf(timestamp, window_start, window_ms, column_count)].add(value);
+            }
+        }
+    }
+}
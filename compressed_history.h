@@ -0,0 +1,114 @@
+#ifndef COMPRESSED_HISTORY_H
+#define COMPRESSED_HISTORY_H
+
+#include <deque>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "column_summary.h"
+
+// Append-only compressed store for samples that no longer fit in the raw
+// ring. Samples are packed Gorilla-style into fixed-size blocks:
+// timestamps as delta-of-delta with variable-width buckets, values as the
+// XOR against the previous value with leading/trailing zero elision. Each
+// block also keeps its time span and min/max/first/last, so range scans
+// only decode blocks that straddle a boundary.
+class CompressedHistory {
+private:
+    static const size_t BLOCK_WORDS = 128; // 1 KiB of bitstream per block
+    
+    struct Block {
+        long long first_timestamp;
+        long long last_timestamp;
+        ColumnSummary summary;
+        size_t bit_count;
+        
+        // Encoder state for the next append
+        long long previous_delta;
+        uint64_t previous_bits;
+        int previous_leading;
+        int previous_trailing;
+        
+        uint64_t words[BLOCK_WORDS];
+        
+        void writeBits(uint64_t value, int bits);
+    };
+    
+    // Sequential decoder over one block
+    struct BlockReader {
+        const Block& block;
+        size_t bit_position;
+        size_t remaining;
+        long long timestamp;
+        long long delta;
+        uint64_t bits;
+        int leading;
+        int trailing;
+        
+        explicit BlockReader(const Block& b);
+        uint64_t readBits(int count);
+        bool next(long long& out_timestamp, double& out_value);
+    };
+    
+    std::deque<Block> blocks; // Oldest first; the last block is open
+    size_t sample_count;
+    size_t byte_limit;
+    
+    // Cached extremes of the sealed blocks
+    bool extremes_valid;
+    double sealed_min;
+    double sealed_max;
+    
+    void startBlock(long long timestamp, double value);
+    bool appendToBlock(Block& block, long long timestamp, double value);
+    void dropOldestBlock();
+    void refreshExtremes();
+    
+public:
+    explicit CompressedHistory(size_t limit = 0);
+    
+    // Maximum memory for the blocks; the oldest are dropped beyond it, so
+    // the more a series compresses, the more samples it keeps
+    void setLimit(size_t bytes);
+    
+    // Append a sample; timestamps (ms) must be non-decreasing. O(1).
+    void append(long long timestamp, double value);
+    
+    // Drop blocks whose samples are all older than cutoff
+    void expire(long long cutoff);
+    
+    void clear();
+    
+    // Fold samples in [window_start, window_start + window_ms) into
+    // column_count columns spanning the window. Blocks that fit in a single
+    // column are folded from their summary, so only blocks straddling a
+    // column boundary are decoded.
+    void summarize(long long window_start, long long window_ms,
+                   ColumnSummary* columns, int column_count) const;
+    
+    // Decode every sample, oldest first, into visit(timestamp_ms, value)
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        long long timestamp;
+        double value;
+        for (const Block& block : blocks) {
+            BlockReader reader(block);
+            while (reader.next(timestamp, value)) {
+                visit(timestamp, value);
+            }
+        }
+    }
+    
+    // Min/max over everything stored; false if empty
+    bool getExtremes(double& min_value, double& max_value);
+    
+    bool empty() const { return sample_count == 0; }
+    size_t size() const { return sample_count; }
+    size_t getLimit() const { return byte_limit; }
+    long long frontTimestamp() const { return blocks.front().first_timestamp; }
+    
+    // Memory held by the blocks
+    size_t getBytes() const { return blocks.size() * sizeof(Block); }
+};
+
+#endif // COMPRESSED_HISTORY_H
@@ -1,114 +1,419 @@
 #include "data_parser.h"
-#include <sstream>
-#include <algorithm>
-#include <cctype>
+#include "wire_format.h"
 #include <cstdlib>
-#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+#include <algorithm>
+#include <locale.h>
+#include <stdint.h>
 
-DataParser::DataParser() {
+namespace {
+    // Token delimiters: space, newline, comma, tab and friends
+    struct DelimiterTable {
+        bool is_delimiter[256];
+        DelimiterTable() {
+            memset(is_delimiter, 0, sizeof(is_delimiter));
+            const char* delimiters = " \n\r\t\v\f,;";
+            for (const char* d = delimiters; *d; ++d) {
+                is_delimiter[(unsigned char)*d] = true;
+            }
+        }
+    };
+    const DelimiterTable DELIMITERS;
+    
+    // Powers of ten that are exactly representable as doubles
+    const double EXACT_POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const int MAX_EXACT_POWER = 22;
+    
+    // Mantissas below 2^53 convert to double exactly
+    const int MAX_FAST_DIGITS = 15;
+    
+    // Slow path for numbers the fast path cannot round correctly
+    double strtodC(const char* begin, const char* end) {
+        static locale_t c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+        
+        char buffer[64];
+        size_t length = end - begin;
+        if (length < sizeof(buffer)) {
+            memcpy(buffer, begin, length);
+            buffer[length] = '\0';
+            return strtod_l(buffer, nullptr, c_locale);
+        }
+        
+        std::string copy(begin, end);
+        return strtod_l(copy.c_str(), nullptr, c_locale);
+    }
+    
+    // Seconds since the epoch with up to nine fractional digits, converted
+    // to ns exactly (a double would lose the sub-microsecond part)
+    bool parseSeconds(const char* p, const char* end, long long& out_ns) {
+        long long seconds = 0;
+        int digits = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+            if (digits >= 11) {
+                return false; // Beyond year 5000
+            }
+            seconds = seconds * 10 + (*p - '0');
+        }
+        
+        long long fraction = 0;
+        int fraction_digits = 0;
+        if (p < end && *p == '.') {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+                if (fraction_digits < 9) {
+                    fraction = fraction * 10 + (*p - '0');
+                    ++fraction_digits;
+                }
+            }
+        }
+        if (p != end || digits + fraction_digits == 0 || seconds >= LLONG_MAX / 1000000000LL) {
+            return false; // Malformed, or past 2262 and out of range in ns
+        }
+        for (; fraction_digits < 9; ++fraction_digits) {
+            fraction *= 10;
+        }
+        out_ns = seconds * 1000000000LL + fraction;
+        return true;
+    }
+    
+    // True if values stamped from base_ns to span_ns later all stay within
+    // the sender skew allowed around receive_ns. Written as differences
+    // from receive_ns so wild sender values cannot overflow.
+    bool plausibleTiming(long long base_ns, long long span_ns, long long receive_ns) {
+        if (base_ns < receive_ns - DataParser::MAX_SENDER_LAG_NS ||
+            base_ns > receive_ns + DataParser::MAX_SENDER_LEAD_NS) {
+            return false;
+        }
+        return span_ns <= receive_ns + DataParser::MAX_SENDER_LEAD_NS - base_ns;
+    }
+    
+    // Restamp samples[first, end) from sender-supplied timing. Each
+    // channel's values are spaced interval_ns apart: forward from base_ns if
+    // given, else back from receive_ns so the newest value lands on it.
+    // Returns false if the timing was implausible: a bad base_ns is dropped
+    // for receive_ns, and spacing that would reach back further than
+    // MAX_SENDER_LAG_NS from it is dropped too.
+    bool spreadTimestamps(std::vector<Sample>& samples, size_t first, bool has_base, long long base_ns,
+                          long long interval_ns, long long receive_ns) {
+        uint32_t totals[ChannelRegistry::MAX_CHANNELS];
+        uint32_t seen[ChannelRegistry::MAX_CHANNELS];
+        memset(totals, 0, sizeof(totals));
+        memset(seen, 0, sizeof(seen));
+        uint32_t longest = 0;
+        for (size_t i = first; i < samples.size(); ++i) {
+            longest = std::max(longest, ++totals[samples[i].channel]);
+        }
+        
+        long long span_ns = (longest > 0 ? longest - 1 : 0) * interval_ns;
+        bool plausible = has_base ? plausibleTiming(base_ns, span_ns, receive_ns)
+                                  : span_ns <= DataParser::MAX_SENDER_LAG_NS;
+        has_base = has_base && plausible;
+        if (!has_base && span_ns > DataParser::MAX_SENDER_LAG_NS) {
+            plausible = false;
+            interval_ns = 0;
+        }
+        
+        for (size_t i = first; i < samples.size(); ++i) {
+            Sample& sample = samples[i];
+            long long index = seen[sample.channel]++;
+            if (has_base) {
+                sample.timestamp_ns = base_ns + index * interval_ns;
+            } else {
+                sample.timestamp_ns = receive_ns - (totals[sample.channel] - 1 - index) * interval_ns;
+            }
+        }
+        return plausible;
+    }
+}
+
+const long long DataParser::MAX_SENDER_LEAD_NS;
+const long long DataParser::MAX_SENDER_LAG_NS;
+
+DataParser::DataParser(ChannelRegistry* shared_channels)
+    : malformed_count(0), channels(shared_channels ? shared_channels : &own_channels), sender_time_offset(0),
+      has_sequence(false), sequence(0) {
 }
 
 std::vector<double> DataParser::parseData(const std::string& data) {
-    std::vector<double> values;
+    std::vector<Sample> samples;
+    parseInto(data.data(), data.size(), samples, currentTimeNs());
     
-    if (data.empty()) {
-        return values;
+    std::vector<double> values;
+    values.reserve(samples.size());
+    for (const Sample& sample : samples) {
+        values.push_back(sample.value);
+    }
+    return values;
+}
+
+size_t DataParser::parseInto(const char* data, size_t length, std::vector<Sample>& samples,
+                             long long timestamp_ns) {
+    has_sequence = false;
+    if (isWireDatagram(data, length)) {
+        return parseWire(data, length, samples, timestamp_ns);
     }
     
-    // Split the data by common delimiters (space, newline, comma, tab)
-    std::vector<std::string> tokens = split(data, " \n\r\t,;");
+    size_t first = samples.size();
+    size_t appended = 0;
+    bool has_base = false;
+    long long base_ns = 0;
+    long long interval_ns = -1; // No timing directives seen
+    const char* end = data + length;
+    const char* p = data;
     
-    for (const std::string& token : tokens) {
-        std::string trimmed = trim(token);
+    while (p < end) {
+        // Skip delimiters
+        while (p < end && DELIMITERS.is_delimiter[(unsigned char)*p]) {
+            ++p;
+        }
+        if (p == end) {
+            break;
+        }
         
-        if (!trimmed.empty() && isValidNumber(trimmed)) {
-            try {
-                double value = std::stod(trimmed);
-                values.push_back(value);
-            } catch (const std::exception& e) {
-                std::cerr << "Warning: Failed to parse number '" << trimmed << "': " << e.what() << std::endl;
+        // Find the end of the token
+        const char* token = p;
+        while (p < end && !DELIMITERS.is_delimiter[(unsigned char)*p]) {
+            ++p;
+        }
+        
+        if (*token == '@') {
+            if (!parseDirective(token, p, has_base, base_ns, interval_ns)) {
+                ++malformed_count;
             }
-        } else if (!trimmed.empty()) {
-            std::cerr << "Warning: Ignoring invalid number '" << trimmed << "'" << std::endl;
+            continue;
+        }
+        
+        // Tagged sample: name=value
+        Sample sample;
+        sample.timestamp_ns = timestamp_ns;
+        sample.channel = ChannelRegistry::DEFAULT_CHANNEL;
+        const char* number = token;
+        const char* equals = (const char*)memchr(token, '=', p - token);
+        if (equals) {
+            sample.channel = channels->intern(token, equals - token);
+            number = equals + 1;
+        }
+        
+        if (sample.channel != ChannelRegistry::INVALID_CHANNEL && parseNumber(number, p, sample.value)) {
+            samples.push_back(sample);
+            ++appended;
+        } else {
+            ++malformed_count;
         }
     }
     
-    return values;
+    if ((has_base || interval_ns >= 0) &&
+        !spreadTimestamps(samples, first, has_base, base_ns, interval_ns < 0 ? 0 : interval_ns, timestamp_ns)) {
+        ++malformed_count;
+    }
+    return appended;
 }
 
-bool DataParser::isValidNumber(const std::string& str) const {
-    if (str.empty()) {
+bool DataParser::parseDirective(const char* begin, const char* end, bool& has_base, long long& base_ns,
+                                long long& interval_ns) {
+    const char* equals = (const char*)memchr(begin, '=', end - begin);
+    if (!equals) {
         return false;
     }
+    size_t name_length = equals - begin;
     
-    size_t start = 0;
-    
-    // Skip leading sign
-    if (str[0] == '+' || str[0] == '-') {
-        start = 1;
-        if (str.length() == 1) {
+    if (name_length == 2 && memcmp(begin, "@t", 2) == 0) {
+        if (!parseSeconds(equals + 1, end, base_ns)) {
             return false;
         }
+        base_ns += sender_time_offset;
+        has_base = true;
+        return true;
+    }
+    if (name_length == 3 && memcmp(begin, "@dt", 3) == 0) {
+        double seconds;
+        if (!parseNumber(equals + 1, end, seconds) || seconds < 0 || seconds > 86400) {
+            return false;
+        }
+        interval_ns = std::llround(seconds * 1e9);
+        return true;
+    }
+    if (name_length == 4 && memcmp(begin, "@seq", 4) == 0) {
+        uint64_t number = 0;
+        const char* p = equals + 1;
+        if (p == end || end - p > 20) {
+            return false;
+        }
+        for (; p < end; ++p) {
+            if (*p < '0' || *p > '9') {
+                return false;
+            }
+            number = number * 10 + (*p - '0');
+        }
+        sequence = number;
+        has_sequence = true;
+        return true;
+    }
+    return false;
+}
+
+size_t DataParser::parseWire(const char* data, size_t length, std::vector<Sample>& samples,
+                             long long timestamp_ns) {
+    WireHeader header;
+    if (!decodeWireHeader(data, length, header)) {
+        ++malformed_count;
+        return 0;
+    }
+    has_sequence = (header.flags & WIRE_FLAG_SEQUENCE) != 0;
+    sequence = header.sequence;
+    
+    // Wire channel 0 is the default channel, others are named "chN"
+    Sample sample;
+    sample.channel = ChannelRegistry::DEFAULT_CHANNEL;
+    if (header.channel != 0) {
+        char name[16];
+        int name_length = snprintf(name, sizeof(name), "ch%u", (unsigned)header.channel);
+        sample.channel = channels->intern(name, name_length);
+        if (sample.channel == ChannelRegistry::INVALID_CHANNEL) {
+            ++malformed_count;
+            return 0;
+        }
     }
     
-    bool has_digit = false;
-    bool has_decimal = false;
-    bool has_exponent = false;
+    // Sample i is taken at base + i * interval, where the base is the
+    // sender's timestamp or, without one or with an implausible one, puts
+    // the last sample at receive time. Spacing that would then reach back
+    // further than MAX_SENDER_LAG_NS is dropped.
+    long long interval_ns = header.interval_ns;
+    long long span_ns = (header.count > 0 ? header.count - 1 : 0) * interval_ns;
+    bool has_base = (header.flags & WIRE_FLAG_TIMESTAMP) != 0;
+    bool plausible = has_base ? plausibleTiming(header.timestamp_ns, span_ns, timestamp_ns - sender_time_offset)
+                              : span_ns <= MAX_SENDER_LAG_NS;
+    has_base = has_base && plausible;
+    if (!has_base && span_ns > MAX_SENDER_LAG_NS) {
+        interval_ns = 0;
+        span_ns = 0;
+    }
+    if (!plausible) {
+        ++malformed_count;
+    }
+    long long base_ns = has_base ? header.timestamp_ns + sender_time_offset : timestamp_ns - span_ns;
     
-    for (size_t i = start; i < str.length(); ++i) {
-        char c = str[i];
-        
-        if (std::isdigit(c)) {
-            has_digit = true;
-        } else if (c == '.' && !has_decimal && !has_exponent) {
-            has_decimal = true;
-        } else if ((c == 'e' || c == 'E') && !has_exponent && has_digit) {
-            has_exponent = true;
-            // Check for exponent sign
-            if (i + 1 < str.length() && (str[i + 1] == '+' || str[i + 1] == '-')) {
-                ++i; // Skip the sign
-            }
+    // Samples are already binary, just widen them to double
+    size_t appended = 0;
+    for (size_t i = 0; i < header.count; ++i) {
+        sample.value = decodeWireSample(data, header, i);
+        sample.timestamp_ns = base_ns + (long long)i * interval_ns;
+        if (std::isfinite(sample.value)) {
+            samples.push_back(sample);
+            ++appended;
         } else {
-            return false;
+            ++malformed_count;
         }
     }
     
-    return has_digit;
+    return appended;
 }
 
-std::string DataParser::trim(const std::string& str) const {
-    size_t start = 0;
-    size_t end = str.length();
+bool DataParser::parseNumber(const char* begin, const char* end, double& out) const {
+    const char* p = begin;
+    bool negative = false;
+    
+    // Skip leading sign
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        ++p;
+    }
     
-    // Find first non-whitespace character
-    while (start < end && std::isspace(str[start])) {
-        ++start;
+    uint64_t mantissa = 0;
+    int significant_digits = 0;
+    int decimal_exponent = 0;
+    bool has_digit = false;
+    
+    // Integer part
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        has_digit = true;
+        if (mantissa == 0 && *p == '0') {
+            continue; // Leading zeros are not significant
+        }
+        if (significant_digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+        } else {
+            ++decimal_exponent; // Dropped digit, handled by the slow path
+        }
+        ++significant_digits;
     }
     
-    // Find last non-whitespace character
-    while (end > start && std::isspace(str[end - 1])) {
-        --end;
+    // Fractional part
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            has_digit = true;
+            if (mantissa == 0 && *p == '0') {
+                --decimal_exponent;
+                continue;
+            }
+            if (significant_digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                --decimal_exponent;
+            }
+            ++significant_digits;
+        }
     }
     
-    return str.substr(start, end - start);
-}
-
-std::vector<std::string> DataParser::split(const std::string& str, const std::string& delimiters) const {
-    std::vector<std::string> tokens;
-    size_t start = 0;
-    size_t end = 0;
+    if (!has_digit) {
+        return false;
+    }
     
-    while ((end = str.find_first_of(delimiters, start)) != std::string::npos) {
-        if (end != start) {
-            tokens.push_back(str.substr(start, end - start));
+    // Exponent; like the original validator, a bare "e" or "e+" is allowed
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negative_exponent = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negative_exponent = *p == '-';
+            ++p;
         }
-        start = end + 1;
+        int exponent = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+            if (exponent < 100000) {
+                exponent = exponent * 10 + (*p - '0');
+            }
+        }
+        decimal_exponent += negative_exponent ? -exponent : exponent;
+    }
+    
+    if (p != end) {
+        return false; // Trailing garbage
     }
     
-    // Add the last token if there's remaining content
-    if (start < str.length()) {
-        tokens.push_back(str.substr(start));
+    if (mantissa == 0) {
+        out = negative ? -0.0 : 0.0;
+        return true;
     }
     
-    return tokens;
+    // Fast path: an exact mantissa scaled by an exact power of ten is
+    // correctly rounded by a single multiply or divide
+    if (significant_digits <= MAX_FAST_DIGITS &&
+        decimal_exponent >= -MAX_EXACT_POWER && decimal_exponent <= MAX_EXACT_POWER) {
+        double value = (double)mantissa;
+        if (decimal_exponent < 0) {
+            value /= EXACT_POWERS_OF_TEN[-decimal_exponent];
+        } else {
+            value *= EXACT_POWERS_OF_TEN[decimal_exponent];
+        }
+        out = negative ? -value : value;
+        return true;
+    }
+    
+    // Out of range values would break autoscaling, treat them as malformed
+    double value = strtodC(begin, end);
+    if (!std::isfinite(value)) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+bool DataParser::isValidNumber(const std::string& str) const {
+    double value;
+    return parseNumber(str.data(), str.data() + str.size(), value);
 }
@@ -3,23 +3,85 @@
 
 #include <vector>
 #include <string>
+#include <cstddef>
+#include "sample.h"
+#include "channel_registry.h"
 
 class DataParser {
 public:
-    DataParser();
+    // How far sender-supplied timestamps may lead the receive time (clock
+    // skew) or lag it (a sender's backlog). Timing outside that is counted
+    // as malformed and the values are stamped as if it were absent.
+    static const long long MAX_SENDER_LEAD_NS = 10000000000LL;     // 10 s
+    static const long long MAX_SENDER_LAG_NS = 7 * 86400000000000LL; // 7 days
+    
+private:
+    unsigned long long malformed_count;
+    ChannelRegistry own_channels;
+    ChannelRegistry* channels; // own_channels unless a shared registry was given
+    long long sender_time_offset; // Added to sender-supplied timestamps
+    bool has_sequence; // The last datagram carried a sequence number
+    uint64_t sequence;
+    
+    // Convert [begin, end) to a double if the whole range is a valid number.
+    // Locale independent and allocation free for ordinary inputs.
+    bool parseNumber(const char* begin, const char* end, double& out) const;
+    
+    // Handle an @name=value timing or sequence directive; false if it is not one
+    bool parseDirective(const char* begin, const char* end, bool& has_base, long long& base_ns,
+                        long long& interval_ns);
+    
+    // Decode a datagram in the binary wire format (see wire_format.h)
+    size_t parseWire(const char* data, size_t length, std::vector<Sample>& samples, long long timestamp_ns);
+    
+public:
+    // Channel names are interned into shared_channels if given, so several
+    // parsers can agree on channel ids
+    explicit DataParser(ChannelRegistry* shared_channels = nullptr);
     
     // Parse incoming data string and extract numeric values
     std::vector<double> parseData(const std::string& data);
     
+    // Parse the values in data[0, length) and append them to samples,
+    // stamped with timestamp_ns (normally the receive time).
+    // Tokens are either bare numbers (default channel) or name=value pairs,
+    // whose names are interned into getChannels(). Binary datagrams are
+    // detected by their magic and decoded directly. Does not allocate once
+    // samples has enough capacity and the channels are known. Tokens that
+    // are not numbers are counted in getMalformedCount(). Returns the number
+    // of samples appended.
+    //
+    // Senders that batch values can supply their timing with directives
+    // anywhere in the datagram: @t=SECONDS (since the epoch, fractional)
+    // stamps each channel's first value, and @dt=SECONDS spaces each
+    // channel's values. With @dt alone, a channel's last value is stamped
+    // timestamp_ns and earlier values are spaced back from it. Binary
+    // datagrams carry the same fields in their header. A base that would
+    // put any value outside MAX_SENDER_LEAD_NS/MAX_SENDER_LAG_NS of
+    // timestamp_ns is ignored, as is an interval that would then space
+    // values back further than MAX_SENDER_LAG_NS; either counts the
+    // datagram as malformed.
+    //
+    // @seq=N (a decimal integer) numbers the datagram for loss accounting;
+    // see getSequence().
+    size_t parseInto(const char* data, size_t length, std::vector<Sample>& samples, long long timestamp_ns);
+    
+    // The sequence number of the datagram last given to parseInto(), false
+    // if it had none
+    bool getSequence(uint64_t& out) const {
+        out = sequence;
+        return has_sequence;
+    }
+    
+    // Shift sender-supplied timestamps, e.g. to move a replayed capture
+    // into the present
+    void setSenderTimeOffset(long long offset_ns) { sender_time_offset = offset_ns; }
+    
     // Validate if a string represents a valid number
     bool isValidNumber(const std::string& str) const;
     
-private:
-    // Helper function to trim whitespace
-    std::string trim(const std::string& str) const;
-    
-    // Split string by delimiters
-    std::vector<std::string> split(const std::string& str, const std::string& delimiters) const;
+    unsigned long long getMalformedCount() const { return malformed_count; }
+    const ChannelRegistry& getChannels() const { return *channels; }
 };
 
 #endif // DATA_PARSER_H
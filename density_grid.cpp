@@ -0,0 +1,105 @@
+#include "density_grid.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+const int DensityGrid::BUCKETS;
+
+DensityGrid::DensityGrid() : column_ns(1) {
+}
+
+void DensityGrid::reset(int column_count, long long bucket_ns) {
+    columns.assign(std::max(1, column_count), Column());
+    for (Column& column : columns) {
+        column.index = -1;
+    }
+    column_ns = std::max(1LL, bucket_ns);
+}
+
+void DensityGrid::add(long long timestamp_ns, double value, double hint_low, double hint_high) {
+    if (columns.empty() || !std::isfinite(value)) {
+        return;
+    }
+    
+    long long index = bucketOf(timestamp_ns);
+    Column& column = columns[(size_t)(index % (long long)columns.size())];
+    if (column.index != index) {
+        if (column.index > index) {
+            return; // Older than anything the ring still holds
+        }
+        
+        // First sample of this time bucket: reuse the slot at the given range
+        column.index = index;
+        std::memset(column.counts, 0, sizeof(column.counts));
+        double span = hint_high - hint_low;
+        if (!(span > 0) || !std::isfinite(span)) {
+            span = std::max(1.0, std::abs(value));
+            hint_low = value - span / 2;
+        }
+        column.low = hint_low;
+        column.width = span / BUCKETS;
+    }
+    
+    int bucket = (int)std::floor((value - column.low) / column.width);
+    if (bucket < 0 || bucket >= BUCKETS) {
+        widen(column, value);
+        bucket = std::min(BUCKETS - 1, std::max(0, (int)std::floor((value - column.low) / column.width)));
+    }
+    ++column.counts[bucket];
+}
+
+void DensityGrid::widen(Column& column, double value) {
+    while (value < column.low || value >= column.low + column.width * BUCKETS) {
+        double top = column.low + column.width * BUCKETS;
+        if (value >= top) {
+            // Grow upwards: bucket i takes old buckets 2i and 2i+1
+            for (int i = 0; i < BUCKETS / 2; ++i) {
+                column.counts[i] = column.counts[2 * i] + column.counts[2 * i + 1];
+            }
+            std::memset(column.counts + BUCKETS / 2, 0, sizeof(column.counts) / 2);
+            column.width *= 2;
+        } else {
+            // Grow downwards, keeping the top edge
+            for (int i = BUCKETS - 1; i >= BUCKETS / 2; --i) {
+                int source = 2 * i - BUCKETS;
+                column.counts[i] = column.counts[source] + column.counts[source + 1];
+            }
+            std::memset(column.counts, 0, sizeof(column.counts) / 2);
+            column.width *= 2;
+            column.low = top - column.width * BUCKETS;
+        }
+    }
+}
+
+void DensityGrid::spread(long long time_bucket, double top, double row_height, int rows, float* out) const {
+    if (columns.empty() || time_bucket < 0 || !(row_height > 0)) {
+        return;
+    }
+    const Column& column = columns[(size_t)(time_bucket % (long long)columns.size())];
+    if (column.index != time_bucket) {
+        return;
+    }
+    
+    for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+        uint32_t count = column.counts[bucket];
+        if (count == 0) {
+            continue;
+        }
+        
+        // The bucket's extent in fractional display rows
+        double bucket_high = column.low + (bucket + 1) * column.width;
+        double first = (top - bucket_high) / row_height;
+        double last = first + column.width / row_height;
+        if (last <= 0 || first >= rows) {
+            continue;
+        }
+        
+        double per_row = count / (last - first);
+        int row_begin = std::max(0, (int)std::floor(first));
+        int row_end = std::min(rows, (int)std::ceil(last));
+        for (int row = row_begin; row < row_end; ++row) {
+            double overlap = std::min(last, row + 1.0) - std::max(first, (double)row);
+            out[row] += (float)(per_row * overlap);
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef DENSITY_GRID_H
+#define DENSITY_GRID_H
+
+#include <vector>
+#include <stdint.h>
+
+// Sample density for the heatmap: a ring of time columns, each a histogram
+// of value buckets, updated per sample so drawing never touches raw data.
+//
+// Every column has its own value range. A new column starts at the range
+// the caller suggests (the current autoscale); a value outside it doubles
+// the bucket width, merging bucket pairs, so a column rescales at most a
+// logarithmic number of times. A spike therefore only coarsens the columns
+// it lands in, and the range narrows again as those scroll out.
+class DensityGrid {
+public:
+    static const int BUCKETS = 64;
+
+private:
+    struct Column {
+        long long index; // Absolute time bucket held here, -1 if never used
+        double low;      // Bottom of bucket 0
+        double width;    // Value span of one bucket
+        uint32_t counts[BUCKETS];
+    };
+    
+    std::vector<Column> columns; // Ring indexed by time bucket
+    long long column_ns;
+    
+    static void widen(Column& column, double value);
+
+public:
+    DensityGrid();
+    
+    // Drop everything and hold column_count columns of bucket_ns each
+    void reset(int column_count, long long bucket_ns);
+    
+    // Count a sample; hint_low/hint_high seed the range of a new column.
+    // Columns that have scrolled out of the ring are reused lazily.
+    void add(long long timestamp_ns, double value, double hint_low, double hint_high);
+    
+    // Time bucket containing timestamp_ns
+    long long bucketOf(long long timestamp_ns) const { return timestamp_ns / column_ns; }
+    
+    // Add time bucket's counts to out[0..rows), spread over display rows of
+    // row_height value units each, row 0 starting at top and going down.
+    // Buckets straddling rows are split in proportion to the overlap.
+    void spread(long long time_bucket, double top, double row_height, int rows, float* out) const;
+    
+    long long getColumnNs() const { return column_ns; }
+    int getColumnCount() const { return (int)columns.size(); }
+};
+
+#endif // DENSITY_GRID_H
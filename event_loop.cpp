@@ -0,0 +1,150 @@
+#include "event_loop.h"
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <stdexcept>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+void Wakeup::arm() {
+    armed.store(true, std::memory_order_relaxed);
+    // Order the store before the consumer's next look at the queues
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void Wakeup::notify() {
+    // Order the producer's queue writes before the load of armed
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (armed.load(std::memory_order_relaxed) && armed.exchange(false, std::memory_order_relaxed)) {
+        uint64_t one = 1;
+        ssize_t written = write(fd, &one, sizeof(one));
+        (void)written; // A full counter means a wakeup is already pending
+    }
+}
+
+namespace {
+    void addToEpoll(int epoll_fd, int fd) {
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            throw std::runtime_error("Failed to watch fd: " + std::string(strerror(errno)));
+        }
+    }
+}
+
+EventLoop::EventLoop()
+    : epoll_fd(-1), signal_fd(-1), timer_fd(-1),
+      wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), input_fd(-1), timer_armed(false), wakeup(wake_fd) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd < 0 || signal_fd < 0 || timer_fd < 0 || wake_fd < 0) {
+        std::string error = strerror(errno);
+        closeAll();
+        throw std::runtime_error("Failed to set up the event loop: " + error);
+    }
+    
+    try {
+        addToEpoll(epoll_fd, signal_fd);
+        addToEpoll(epoll_fd, timer_fd);
+        addToEpoll(epoll_fd, wake_fd);
+    } catch (...) {
+        closeAll();
+        throw;
+    }
+}
+
+EventLoop::~EventLoop() {
+    closeAll();
+}
+
+void EventLoop::closeAll() {
+    int fds[] = { epoll_fd, signal_fd, timer_fd, wake_fd };
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    epoll_fd = signal_fd = timer_fd = wake_fd = -1;
+}
+
+void EventLoop::watchInput(int fd) {
+    addToEpoll(epoll_fd, fd);
+    input_fd = fd;
+}
+
+void EventLoop::armTimer(long long delay_ns) {
+    if (delay_ns <= 0 && !timer_armed) {
+        return;
+    }
+    timer_armed = delay_ns > 0;
+    
+    struct itimerspec timer;
+    std::memset(&timer, 0, sizeof(timer));
+    if (delay_ns > 0) {
+        timer.it_value.tv_sec = delay_ns / 1000000000LL;
+        timer.it_value.tv_nsec = delay_ns % 1000000000LL;
+    }
+    timerfd_settime(timer_fd, 0, &timer, nullptr);
+}
+
+EventLoop::Events EventLoop::wait(long long timeout_ns) {
+    Events events = { false, false, false, false, false };
+    
+    // epoll_wait() only has millisecond resolution, so every positive
+    // timeout arms the timerfd and epoll_wait() itself either polls (0) or
+    // blocks until something, the timer included, is ready (-1). Otherwise
+    // any timer left from an earlier wait is disarmed.
+    armTimer(timeout_ns);
+    
+    struct epoll_event ready[5];
+    int count = epoll_wait(epoll_fd, ready, 5, timeout_ns == 0 ? 0 : -1);
+    if (count < 0) {
+        if (errno == EINTR) {
+            return events;
+        }
+        throw std::runtime_error("epoll_wait failed: " + std::string(strerror(errno)));
+    }
+    
+    for (int i = 0; i < count; ++i) {
+        int fd = ready[i].data.fd;
+        if (fd == signal_fd) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+                if (info.ssi_signo == SIGWINCH) {
+                    events.resized = true;
+                } else {
+                    events.interrupted = true;
+                }
+            }
+        } else if (fd == timer_fd) {
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+                events.timer = true;
+                timer_armed = false;
+            }
+        } else if (fd == wake_fd) {
+            uint64_t count_value;
+            if (read(wake_fd, &count_value, sizeof(count_value)) > 0) {
+                events.woken = true;
+            }
+        } else if (fd == input_fd) {
+            events.input = true;
+        }
+    }
+    return events;
+}
@@ -0,0 +1,72 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <atomic>
+
+// Lets producer threads wake a sleeping EventLoop without a syscall per
+// batch: the consumer arms it before it last looks for work, and only the
+// first notify() after that writes the eventfd.
+class Wakeup {
+private:
+    int fd; // eventfd, owned by the EventLoop
+    std::atomic<bool> armed;
+    
+public:
+    explicit Wakeup(int event_fd) : fd(event_fd), armed(false) {}
+    
+    // Consumer: call before the final check for work, then sleep
+    void arm();
+    
+    // Producer: call after publishing work
+    void notify();
+};
+
+// Event loop for the UI thread, built on epoll. Signals arrive through a
+// signalfd, deadlines (frames, stats, replay pacing) through a one-shot
+// timerfd, receive threads wake it through an eventfd and key presses
+// through an optional input fd, so an idle process sleeps with no wakeups
+// at all.
+class EventLoop {
+private:
+    int epoll_fd;
+    int signal_fd;
+    int timer_fd;
+    int wake_fd;
+    int input_fd; // Not owned, -1 if none
+    bool timer_armed; // Saves the syscall when there is nothing to disarm
+    Wakeup wakeup;
+    
+    void closeAll();
+    
+    // Fire the timer once after delay_ns; negative disarms it
+    void armTimer(long long delay_ns);
+    
+public:
+    // What woke wait()
+    struct Events {
+        bool interrupted; // SIGINT or SIGTERM
+        bool resized;     // SIGWINCH
+        bool timer;       // The armed deadline passed
+        bool woken;       // A producer called notify()
+        bool input;       // The input fd has data, left for the caller to read
+    };
+    
+    // Blocks SIGINT, SIGTERM and SIGWINCH in the calling thread so they are
+    // only delivered through the signalfd. Construct it before starting
+    // other threads, which inherit the mask.
+    EventLoop();
+    ~EventLoop();
+    
+    // Sleep until a signal, a wakeup or timeout_ns has passed (negative =
+    // no timeout, 0 = only collect what is already pending), and drain
+    // whatever fired. The timeout has nanosecond resolution.
+    Events wait(long long timeout_ns);
+    
+    // Also wake up when fd (e.g. a raw-mode terminal) becomes readable.
+    // The caller must read all of it, or wait() returns at once.
+    void watchInput(int fd);
+    
+    Wakeup& getWakeup() { return wakeup; }
+};
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,186 @@
+#include "frame_buffer.h"
+#include <unistd.h>
+#include <errno.h>
+#include <cstdio>
+#include <algorithm>
+
+const int16_t FrameBuffer::DEFAULT_COLOR;
+const int16_t FrameBuffer::GREEN;
+const int16_t FrameBuffer::CYAN;
+
+namespace {
+    const Cell BLANK_CELL = { ' ', FrameBuffer::DEFAULT_COLOR, 0 };
+    
+    // Unchanged cells shorter than this between two changes are rewritten
+    // rather than skipped, since a cursor move costs more bytes
+    const int MAX_REWRITE_GAP = 4;
+}
+
+FrameBuffer::FrameBuffer(int w, int h)
+    : width(0), height(0), needs_clear(true), last_frame_bytes(0) {
+    resize(w, h);
+}
+
+void FrameBuffer::resize(int w, int h) {
+    width = w > 0 ? w : 0;
+    height = h > 0 ? h : 0;
+    front.assign(width * height, BLANK_CELL);
+    back.assign(width * height, BLANK_CELL);
+    needs_clear = true;
+}
+
+void FrameBuffer::clear() {
+    std::fill(back.begin(), back.end(), BLANK_CELL);
+}
+
+void FrameBuffer::put(int x, int y, uint32_t glyph, int16_t color, bool bold) {
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+        return;
+    }
+    Cell& cell = back[y * width + x];
+    cell.glyph = glyph;
+    cell.color = color;
+    cell.bold = bold ? 1 : 0;
+}
+
+void FrameBuffer::text(int x, int y, const std::string& str, int16_t color, bool bold) {
+    for (size_t i = 0; i < str.size(); ++i) {
+        put(x + (int)i, y, (unsigned char)str[i], color, bold);
+    }
+}
+
+void FrameBuffer::appendStyle(const Cell& cell) {
+    // Always reset first so the sequence does not depend on the previous state
+    output += "\033[0";
+    if (cell.bold) {
+        output += ";1";
+    }
+    if (cell.color >= 0) {
+        char buf[16];
+        if (cell.color < 8) {
+            snprintf(buf, sizeof(buf), ";%d", 30 + cell.color);
+        } else if (cell.color < 16) {
+            snprintf(buf, sizeof(buf), ";%d", 90 + cell.color - 8);
+        } else {
+            snprintf(buf, sizeof(buf), ";38;5;%d", cell.color);
+        }
+        output += buf;
+    }
+    output += 'm';
+}
+
+void FrameBuffer::appendGlyph(uint32_t glyph) {
+    // UTF-8 encode the code point
+    if (glyph < 0x80) {
+        output += (char)glyph;
+    } else if (glyph < 0x800) {
+        output += (char)(0xC0 | (glyph >> 6));
+        output += (char)(0x80 | (glyph & 0x3F));
+    } else if (glyph < 0x10000) {
+        output += (char)(0xE0 | (glyph >> 12));
+        output += (char)(0x80 | ((glyph >> 6) & 0x3F));
+        output += (char)(0x80 | (glyph & 0x3F));
+    } else {
+        output += (char)(0xF0 | (glyph >> 18));
+        output += (char)(0x80 | ((glyph >> 12) & 0x3F));
+        output += (char)(0x80 | ((glyph >> 6) & 0x3F));
+        output += (char)(0x80 | (glyph & 0x3F));
+    }
+}
+
+void FrameBuffer::appendCursorMove(int row, int col) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "\033[%d;%dH", row + 1, col + 1);
+    output += buf;
+}
+
+void FrameBuffer::present(int fd) {
+    output.clear();
+    
+    if (needs_clear) {
+        // Start from a blank screen so only non-blank cells need drawing
+        output += "\033[0m\033[H\033[2J";
+        std::fill(front.begin(), front.end(), BLANK_CELL);
+        needs_clear = false;
+    }
+    
+    // Every frame leaves the terminal in the default style
+    Cell current_style = BLANK_CELL;
+    
+    for (int y = 0; y < height; ++y) {
+        const Cell* new_row = &back[y * width];
+        const Cell* old_row = &front[y * width];
+        int cursor_col = -1; // Column the cursor is at on this row, -1 if elsewhere
+        
+        int x = 0;
+        while (x < width) {
+            if (new_row[x] == old_row[x]) {
+                ++x;
+                continue;
+            }
+            
+            if (cursor_col != x) {
+                // Rewrite a short unchanged gap instead of moving the cursor
+                if (cursor_col >= 0 && x - cursor_col <= MAX_REWRITE_GAP) {
+                    for (int gx = cursor_col; gx < x; ++gx) {
+                        const Cell& cell = new_row[gx];
+                        if (cell.color != current_style.color || cell.bold != current_style.bold) {
+                            appendStyle(cell);
+                            current_style = cell;
+                        }
+                        appendGlyph(cell.glyph);
+                    }
+                } else {
+                    appendCursorMove(y, x);
+                }
+            }
+            
+            const Cell& cell = new_row[x];
+            if (cell.color != current_style.color || cell.bold != current_style.bold) {
+                appendStyle(cell);
+                current_style = cell;
+            }
+            appendGlyph(cell.glyph);
+            ++x;
+            
+            // After the last column the terminal cursor position is ambiguous
+            cursor_col = x < width ? x : -1;
+        }
+    }
+    
+    if (!output.empty()) {
+        // Leave the terminal in the default style below the frame
+        if (current_style.color != DEFAULT_COLOR || current_style.bold) {
+            output += "\033[0m";
+        }
+        appendCursorMove(height > 0 ? height - 1 : 0, 0);
+    }
+    
+    last_frame_bytes = output.size();
+    
+    // front must only describe what the terminal really shows, or later
+    // diffs would never repair a frame that did not get through
+    if (output.empty() || writeAll(fd)) {
+        front.swap(back);
+    } else {
+        invalidate(); // Some of it may have been written; repaint everything next time
+    }
+}
+
+bool FrameBuffer::writeAll(int fd) {
+    const char* data = output.data();
+    size_t remaining = output.size();
+    
+    while (remaining > 0) {
+        ssize_t written = write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        remaining -= written;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// One terminal cell: a Unicode code point plus its drawing style
+struct Cell {
+    uint32_t glyph;
+    int16_t color; // 256-color palette index, or -1 for the default color
+    uint8_t bold;
+    
+    bool operator==(const Cell& other) const {
+        return glyph == other.glyph && color == other.color && bold == other.bold;
+    }
+    bool operator!=(const Cell& other) const { return !(*this == other); }
+};
+
+// Double-buffered cell grid. Callers draw a complete frame into the back
+// buffer, then present() diffs it against what is on screen and emits only
+// the changed runs, with coalesced SGR state, in a single write().
+class FrameBuffer {
+private:
+    int width;
+    int height;
+    std::vector<Cell> front; // What the terminal currently shows
+    std::vector<Cell> back;  // Frame being composed
+    std::string output;      // Reused escape sequence buffer
+    bool needs_clear;
+    size_t last_frame_bytes;
+    
+    void appendStyle(const Cell& cell);
+    void appendGlyph(uint32_t glyph);
+    void appendCursorMove(int row, int col);
+    bool writeAll(int fd);
+    
+public:
+    static const int16_t DEFAULT_COLOR = -1;
+    
+    // Basic palette entries used by the graph
+    static const int16_t GREEN = 2;
+    static const int16_t CYAN = 6;
+    
+    FrameBuffer(int w = 0, int h = 0);
+    
+    // Change the grid size; the next present() repaints the whole screen
+    void resize(int w, int h);
+    
+    // Forget what is on screen so the next present() repaints everything
+    void invalidate() { needs_clear = true; }
+    
+    // Reset the back buffer to blanks before composing a frame
+    void clear();
+    
+    void put(int x, int y, uint32_t glyph, int16_t color = DEFAULT_COLOR, bool bold = false);
+    
+    // Draw ASCII text starting at (x, y), clipped to the row
+    void text(int x, int y, const std::string& str, int16_t color = DEFAULT_COLOR, bool bold = false);
+    
+    // Emit the difference between the back buffer and the screen to fd. If
+    // the write fails the whole screen is repainted by the next call.
+    void present(int fd);
+    
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    size_t getLastFrameBytes() const { return last_frame_bytes; }
+};
+
+#endif // FRAME_BUFFER_H
@@ -0,0 +1,191 @@
+#include "headless_report.h"
+#include "stats.h"
+#include "sample.h"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/un.h>
+
+const int HeadlessReport::DEFAULT_INTERVAL_MS;
+const size_t HeadlessReport::MAX_WINDOW_INTERVALS;
+
+HeadlessReport::HeadlessReport(const std::string& destination, int interval, size_t intervals_per_window,
+                               const ChannelRegistry* channel_names)
+    : window_intervals(std::max((size_t)1, std::min(intervals_per_window, MAX_WINDOW_INTERVALS))), current(0),
+      interval_ms(interval > 0 ? interval : DEFAULT_INTERVAL_MS), interval_start(monotonicNanos()),
+      channels(channel_names), output_fd(STDOUT_FILENO), datagrams(false), address_length(0) {
+    std::memset(&address, 0, sizeof(address));
+    if (!destination.empty() && destination != "-") {
+        openSocket(destination);
+    }
+}
+
+HeadlessReport::~HeadlessReport() {
+    if (datagrams) {
+        close(output_fd);
+    }
+}
+
+void HeadlessReport::openSocket(const std::string& destination) {
+    if (destination.compare(0, 5, "unix:") == 0) {
+        std::string path = destination.substr(5);
+        struct sockaddr_un* unix_address = (struct sockaddr_un*)&address;
+        if (path.empty() || path.size() >= sizeof(unix_address->sun_path)) {
+            throw std::runtime_error("Invalid Unix socket path: " + path);
+        }
+        unix_address->sun_family = AF_UNIX;
+        std::memcpy(unix_address->sun_path, path.c_str(), path.size() + 1);
+        address_length = sizeof(struct sockaddr_un);
+    } else if (destination.compare(0, 4, "udp:") == 0) {
+        // The port follows the last colon, so HOST may be an IPv6 address
+        std::string target = destination.substr(4);
+        size_t colon = target.rfind(':');
+        if (colon == std::string::npos || colon == 0 || colon + 1 == target.size()) {
+            throw std::runtime_error("Expected udp:HOST:PORT, got " + destination);
+        }
+        std::string host = target.substr(0, colon);
+        if (host.size() > 2 && host[0] == '[' && host[host.size() - 1] == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+        
+        struct addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo* found = nullptr;
+        int error = getaddrinfo(host.c_str(), target.c_str() + colon + 1, &hints, &found);
+        if (error != 0) {
+            throw std::runtime_error("Cannot resolve " + destination + ": " + gai_strerror(error));
+        }
+        std::memcpy(&address, found->ai_addr, found->ai_addrlen);
+        address_length = found->ai_addrlen;
+        freeaddrinfo(found);
+    } else {
+        throw std::runtime_error("Report destination must be -, udp:HOST:PORT or unix:PATH, got " + destination);
+    }
+    
+    output_fd = socket(address.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (output_fd < 0) {
+        throw std::runtime_error("Failed to create report socket: " + std::string(strerror(errno)));
+    }
+    datagrams = true;
+}
+
+void HeadlessReport::grow(uint16_t channel) {
+    windows.resize(channel + 1);
+    for (ChannelWindow& window : windows) {
+        window.intervals.resize(window_intervals);
+    }
+}
+
+long long HeadlessReport::nanosUntilTick() const {
+    long long remaining = (long long)(interval_start + (uint64_t)interval_ms * 1000000ULL - monotonicNanos());
+    return remaining > 0 ? remaining : 0;
+}
+
+bool HeadlessReport::tick() {
+    uint64_t now = monotonicNanos();
+    uint64_t interval_ns = (uint64_t)interval_ms * 1000000ULL;
+    if (now - interval_start < interval_ns) {
+        return false;
+    }
+    // Stay on the interval grid unless a whole interval was missed
+    interval_start += interval_ns;
+    if (now - interval_start >= interval_ns) {
+        interval_start = now;
+    }
+    
+    writeLines();
+    
+    // The oldest interval leaves the window and is refilled from now on
+    size_t next = (current + 1) % window_intervals;
+    for (ChannelWindow& window : windows) {
+        advance(window, next);
+    }
+    current = next;
+    return true;
+}
+
+void HeadlessReport::advance(ChannelWindow& window, size_t next) {
+    window.finished.merge(window.intervals[current]);
+    
+    // Sum and extremes of what stays are rebuilt from the other intervals,
+    // which is cheap next to their buckets
+    ValueSketch& expired = window.intervals[next];
+    double sum = 0;
+    double min_value = std::numeric_limits<double>::infinity();
+    double max_value = -std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < window.intervals.size(); ++i) {
+        const ValueSketch& sketch = window.intervals[i];
+        if (i != next && sketch.getCount() > 0) {
+            sum += sketch.getSum();
+            min_value = std::min(min_value, sketch.getMin());
+            max_value = std::max(max_value, sketch.getMax());
+        }
+    }
+    window.finished.subtract(expired, sum, min_value, max_value);
+    expired.reset();
+}
+
+void HeadlessReport::flush() {
+    writeLines();
+}
+
+void HeadlessReport::writeLines() {
+    long long time_ms = currentTimeMs();
+    output.clear();
+    
+    for (size_t channel = 0; channel < windows.size(); ++channel) {
+        merged.reset();
+        merged.merge(windows[channel].finished);
+        merged.merge(windows[channel].intervals[current]);
+        if (merged.getCount() == 0) {
+            continue;
+        }
+        
+        std::string name = channels ? channels->getName((uint16_t)channel) : std::string();
+        if (name.empty()) {
+            name = channel == ChannelRegistry::DEFAULT_CHANNEL ? "value" : "ch" + std::to_string(channel);
+        }
+        
+        char line[512];
+        int length = std::snprintf(line, sizeof(line),
+                                   "time_ms=%lld channel=%s count=%llu min=%.6g max=%.6g mean=%.6g "
+                                   "p50=%.6g p90=%.6g p99=%.6g p999=%.6g\n",
+                                   time_ms, name.c_str(), (unsigned long long)merged.getCount(),
+                                   merged.getMin(), merged.getMax(), merged.getMean(),
+                                   merged.quantile(0.5), merged.quantile(0.9), merged.quantile(0.99),
+                                   merged.quantile(0.999));
+        if (length <= 0) {
+            continue;
+        }
+        length = std::min(length, (int)sizeof(line) - 1);
+        
+        if (datagrams) {
+            // Fire and forget: a missing listener must not stop ingest
+            ssize_t sent = sendto(output_fd, line, length, MSG_DONTWAIT, (struct sockaddr*)&address,
+                                  address_length);
+            (void)sent;
+        } else {
+            output.append(line, length);
+        }
+    }
+    
+    // One write per interval on stdout
+    size_t written = 0;
+    while (written < output.size()) {
+        ssize_t result = write(output_fd, output.data() + written, output.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write report: " + std::string(strerror(errno)));
+        }
+        written += result;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef HEADLESS_REPORT_H
+#define HEADLESS_REPORT_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <sys/socket.h>
+#include "value_sketch.h"
+#include "channel_registry.h"
+
+// Summaries for --headless: instead of drawing, every interval emit one
+// line per channel with the count, min, max, mean and p50/p90/p99/p99.9 of
+// the values received over the rolling window (a whole number of intervals,
+// at most MAX_WINDOW_INTERVALS). Each interval gets its own sketch, and a
+// running sketch of the finished intervals in the window takes in each one
+// as it ends and gives back the one that expires, so a tick costs the same
+// however many intervals the window spans.
+//
+// Lines go to stdout, or as datagrams to "udp:HOST:PORT" or "unix:PATH".
+class HeadlessReport {
+private:
+    struct ChannelWindow {
+        std::vector<ValueSketch> intervals; // Ring of per-interval sketches
+        ValueSketch finished; // Merge of the intervals in the ring but current
+    };
+    
+    std::vector<ChannelWindow> windows; // Indexed by channel id, grown on demand
+    ValueSketch merged; // Scratch for the window being reported
+    size_t window_intervals;
+    size_t current; // Interval in each ring that is being filled
+    int interval_ms;
+    uint64_t interval_start;
+    const ChannelRegistry* channels; // Channel names, may be null
+    int output_fd;
+    bool datagrams; // One datagram per line rather than a stream
+    struct sockaddr_storage address; // Datagram destination
+    socklen_t address_length;
+    std::string output;
+    
+    void openSocket(const std::string& destination);
+    void grow(uint16_t channel);
+    void writeLines();
+    
+    // Move the current interval into the finished sketch and expire the
+    // one that current is about to reuse
+    void advance(ChannelWindow& window, size_t next);
+
+public:
+    static const int DEFAULT_INTERVAL_MS = 1000;
+    static const size_t MAX_WINDOW_INTERVALS = 1000;
+    
+    // Throws std::runtime_error if destination is not "", "-", "udp:HOST:PORT"
+    // or "unix:PATH", or the socket cannot be set up. Windows are cut to
+    // MAX_WINDOW_INTERVALS.
+    HeadlessReport(const std::string& destination, int interval = DEFAULT_INTERVAL_MS,
+                   size_t intervals_per_window = 1, const ChannelRegistry* channel_names = nullptr);
+    ~HeadlessReport();
+    
+    void add(double value, uint16_t channel) {
+        if (channel >= windows.size()) {
+            grow(channel);
+        }
+        windows[channel].intervals[current].add(value);
+    }
+    
+    // Nanoseconds until the current interval ends and tick() has work
+    long long nanosUntilTick() const;
+    
+    // Report and start a new interval if the current one has elapsed.
+    // Returns true when lines were emitted.
+    bool tick();
+    
+    // Report the window now, e.g. before exiting
+    void flush();
+};
+
+#endif // HEADLESS_REPORT_H
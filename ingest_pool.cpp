@@ -0,0 +1,152 @@
+#include "ingest_pool.h"
+#include <stdexcept>
+#include <algorithm>
+
+const size_t IngestPool::DRAIN_BATCH;
+
+IngestPool::IngestPool(int port, int shard_count, size_t queue_capacity, OverflowPolicy overflow,
+                       int first_cpu, const std::string& record_path, int receive_buffer, bool gro)
+    : batch(DRAIN_BATCH), merge(std::max(shard_count, 1), DRAIN_BATCH) {
+    if (shard_count < 1) {
+        shard_count = 1;
+    }
+    bool reuse_port = shard_count > 1;
+    
+    try {
+        for (int i = 0; i < shard_count; ++i) {
+            queues.push_back(new SpscQueue<Sample>(queue_capacity, overflow));
+            int cpu = first_cpu >= 0 ? first_cpu + i : -1;
+            TrafficRecorder* recorder = nullptr;
+            if (!record_path.empty()) {
+                // Each shard appends to the same file with its own buffer
+                recorder = new TrafficRecorder(record_path);
+                recorders.push_back(recorder);
+            }
+            receivers.push_back(new Receiver(port, *queues.back(), channels, reuse_port, cpu, recorder,
+                                             receive_buffer, gro));
+        }
+    } catch (...) {
+        stop();
+        for (Receiver* receiver : receivers) delete receiver;
+        for (TrafficRecorder* recorder : recorders) delete recorder;
+        for (SpscQueue<Sample>* queue : queues) delete queue;
+        throw;
+    }
+}
+
+IngestPool::~IngestPool() {
+    // Receivers must stop before the queues they write to go away
+    stop();
+    for (Receiver* receiver : receivers) {
+        delete receiver;
+    }
+    for (TrafficRecorder* recorder : recorders) {
+        delete recorder; // Flushes what the receiver buffered
+    }
+    for (SpscQueue<Sample>* queue : queues) {
+        delete queue;
+    }
+}
+
+void IngestPool::start() {
+    for (Receiver* receiver : receivers) {
+        receiver->start();
+    }
+}
+
+void IngestPool::setInstrumented(bool enabled) {
+    for (Receiver* receiver : receivers) {
+        receiver->setInstrumented(enabled);
+    }
+}
+
+void IngestPool::setWakeup(Wakeup* wakeup) {
+    for (Receiver* receiver : receivers) {
+        receiver->setWakeup(wakeup);
+    }
+}
+
+void IngestPool::stop() {
+    for (Receiver* receiver : receivers) {
+        receiver->stop();
+    }
+}
+
+size_t IngestPool::drain(std::vector<Sample>& out) {
+    size_t shard_count = queues.size();
+    
+    if (shard_count == 1) {
+        // Nothing to merge
+        size_t count = queues[0]->popBatch(&batch[0], DRAIN_BATCH);
+        out.insert(out.end(), batch.begin(), batch.begin() + count);
+        return count;
+    }
+    
+    // Top up every shard's staging buffer, then release what is in order
+    for (size_t i = 0; i < shard_count; ++i) {
+        size_t room;
+        Sample* space = merge.reserve(i, room);
+        if (room > 0) {
+            merge.commit(i, queues[i]->popBatch(space, room));
+        }
+    }
+    return merge.merge(out, currentTimeNs());
+}
+
+long long IngestPool::nanosUntilDue() const {
+    return queues.size() > 1 ? merge.nanosUntilDue(currentTimeNs()) : -1;
+}
+
+void IngestPool::checkFailures() const {
+    for (const Receiver* receiver : receivers) {
+        if (receiver->hasFailed()) {
+            throw std::runtime_error(receiver->getError());
+        }
+    }
+}
+
+unsigned long long IngestPool::getDroppedCount() const {
+    unsigned long long total = 0;
+    for (const SpscQueue<Sample>* queue : queues) {
+        total += queue->getDroppedCount();
+    }
+    return total;
+}
+
+unsigned long long IngestPool::getDatagramCount() const {
+    unsigned long long total = 0;
+    for (const Receiver* receiver : receivers) {
+        total += receiver->getDatagramCount();
+    }
+    return total;
+}
+
+unsigned long long IngestPool::getValueCount() const {
+    unsigned long long total = 0;
+    for (const Receiver* receiver : receivers) {
+        total += receiver->getValueCount();
+    }
+    return total;
+}
+
+void IngestPool::getParseHistogram(HistogramSnapshot& out) const {
+    for (const Receiver* receiver : receivers) {
+        receiver->getParseHistogram().addTo(out);
+    }
+}
+
+unsigned long long IngestPool::getMalformedCount() const {
+    unsigned long long total = 0;
+    for (const Receiver* receiver : receivers) {
+        total += receiver->getMalformedCount();
+    }
+    return total;
+}
+
+LossCounts IngestPool::getLossCounts() const {
+    LossCounts total;
+    for (const Receiver* receiver : receivers) {
+        receiver->getLossCounts(total);
+    }
+    return total;
+}
@@ -0,0 +1,78 @@
+#ifndef INGEST_POOL_H
+#define INGEST_POOL_H
+
+#include <vector>
+#include <string>
+#include "receiver.h"
+#include "traffic_log.h"
+#include "spsc_queue.h"
+#include "channel_registry.h"
+#include "sample.h"
+#include "shard_merge.h"
+
+// A set of receive shards listening on the same port. Each shard has its
+// own socket (SO_REUSEPORT when there is more than one), receive thread and
+// SPSC queue, so shards share nothing on the hot path except the lock-free
+// channel lookup. The UI thread drains all queues and merges the shards'
+// samples in timestamp order, holding back each shard's newest samples
+// until the other shards have caught up with them.
+class IngestPool {
+private:
+    ChannelRegistry channels;
+    std::vector<SpscQueue<Sample>*> queues;
+    std::vector<Receiver*> receivers;
+    std::vector<TrafficRecorder*> recorders;  // One per shard when recording
+    std::vector<Sample> batch;                 // Drain buffer with a single shard
+    ShardMerge merge;                          // Staging and merge with several
+    
+public:
+    // Samples taken from each shard per drain() call
+    static const size_t DRAIN_BATCH = 4096;
+    
+    // Open shard_count sockets on port. With first_cpu >= 0, shard i is
+    // pinned to CPU first_cpu + i. With a record_path, every datagram is
+    // also appended to that traffic log. receive_buffer > 0 sets each
+    // socket's receive buffer in bytes; gro enables coalesced receives.
+    IngestPool(int port, int shard_count, size_t queue_capacity, OverflowPolicy overflow,
+               int first_cpu = -1, const std::string& record_path = std::string(), int receive_buffer = 0,
+               bool gro = false);
+    ~IngestPool();
+    
+    void start();
+    void stop();
+    
+    // Time every parse on every shard; set before start()
+    void setInstrumented(bool enabled);
+    
+    // Wake a sleeping UI thread when samples are queued; set before start()
+    void setWakeup(Wakeup* wakeup);
+    
+    // Move queued samples into out, merged across shards by timestamp.
+    // Returns the number of samples appended.
+    size_t drain(std::vector<Sample>& out);
+    
+    // Time until drain() can hand over samples it is holding back for the
+    // merge, -1 if none
+    long long nanosUntilDue() const;
+    
+    // Throws std::runtime_error if a receive thread died
+    void checkFailures() const;
+    
+    const ChannelRegistry& getChannels() const { return channels; }
+    ChannelRegistry& getChannels() { return channels; } // Interning before start(), e.g. saved names
+    size_t getShardCount() const { return receivers.size(); }
+    unsigned long long getDroppedCount() const;
+    unsigned long long getDatagramCount() const;
+    unsigned long long getValueCount() const;
+    // Add every shard's parse timings (ns per datagram) to out
+    void getParseHistogram(HistogramSnapshot& out) const;
+    unsigned long long getMalformedCount() const;
+    // Kernel drops and sequence gaps summed over the shards
+    LossCounts getLossCounts() const;
+    // Receive buffer each socket was granted, in bytes
+    int getReceiveBuffer() const { return receivers.front()->getReceiveBuffer(); }
+    // The kernel accepted UDP_GRO on the sockets
+    bool isGroEnabled() const { return receivers.front()->isGroEnabled(); }
+};
+
+#endif // INGEST_POOL_H
@@ -0,0 +1,61 @@
+#include "keyboard_input.h"
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <stdexcept>
+#include <unistd.h>
+
+KeyboardInput::KeyboardInput(int terminal_fd) : fd(terminal_fd) {
+    if (tcgetattr(fd, &saved) < 0) {
+        throw std::runtime_error("Failed to read terminal settings: " + std::string(strerror(errno)));
+    }
+    
+    // VMIN and VTIME of 0 make read() return at once, so stdin keeps its
+    // blocking mode, which the shell shares
+    struct termios raw = saved;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &raw) < 0) {
+        throw std::runtime_error("Failed to set up the terminal: " + std::string(strerror(errno)));
+    }
+}
+
+KeyboardInput::~KeyboardInput() {
+    tcsetattr(fd, TCSANOW, &saved);
+}
+
+size_t KeyboardInput::read(std::vector<int>& keys) {
+    size_t appended = 0;
+    unsigned char buffer[64];
+    ssize_t length;
+    while ((length = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < length; ++i) {
+            int key = buffer[i];
+            
+            // Arrows arrive as ESC [ A-D (or ESC O A-D in application mode),
+            // possibly with modifier parameters, in one read; a lone ESC is
+            // the Escape key
+            if (key == KEY_ESCAPE && i + 2 < length && (buffer[i + 1] == '[' || buffer[i + 1] == 'O')) {
+                ssize_t end = i + 2;
+                while (end + 1 < length && buffer[end] >= 0x30 && buffer[end] <= 0x3f) {
+                    ++end; // Parameter bytes such as "1;5"
+                }
+                switch (buffer[end]) {
+                    case 'A': key = KEY_UP; break;
+                    case 'B': key = KEY_DOWN; break;
+                    case 'C': key = KEY_RIGHT; break;
+                    case 'D': key = KEY_LEFT; break;
+                    default: key = 0; break; // Some other sequence
+                }
+                i = end;
+                if (key == 0) {
+                    continue;
+                }
+            }
+            keys.push_back(key);
+            ++appended;
+        }
+    }
+    return appended;
+}
@@ -0,0 +1,36 @@
+#ifndef KEYBOARD_INPUT_H
+#define KEYBOARD_INPUT_H
+
+#include <vector>
+#include <cstddef>
+#include <termios.h>
+
+// Key presses for the interactive view. Puts a terminal in non-canonical
+// mode without echo and with reads that never block, so the event loop can
+// watch the fd and read whatever is pending. Ctrl+C still raises SIGINT.
+// The destructor restores the terminal settings.
+class KeyboardInput {
+private:
+    int fd;
+    struct termios saved;
+    
+public:
+    // Keys without a character of their own, decoded from escape sequences;
+    // everything else is the byte itself
+    enum Key {
+        KEY_ESCAPE = 27,
+        KEY_UP = 256,
+        KEY_DOWN,
+        KEY_RIGHT,
+        KEY_LEFT
+    };
+    
+    // Throws std::runtime_error if terminal_fd is not a terminal
+    explicit KeyboardInput(int terminal_fd);
+    ~KeyboardInput();
+    
+    // Append the keys pressed since the last call; returns how many
+    size_t read(std::vector<int>& keys);
+};
+
+#endif // KEYBOARD_INPUT_H
@@ -1,31 +1,162 @@
 #include <iostream>
 #include <string>
+#include <vector>
 #include <cstring>
-#include <signal.h>
+#include <stdexcept>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
 #include <unistd.h>
+#include <getopt.h>
 #include <sys/ioctl.h>
-#include "udp_listener.h"
+#include "event_loop.h"
+#include "ingest_pool.h"
+#include "replayer.h"
 #include "terminal_graph.h"
-#include "data_parser.h"
+#include "render_scheduler.h"
+#include "headless_report.h"
+#include "keyboard_input.h"
+#include "shared_feed.h"
+#include "stats.h"
 
-// Global variables for signal handling
-bool running = true;
-bool terminal_resized = false;
-UDPListener* listener = nullptr;
+// Owned by main(); the event loop outlives the receive threads that wake it
+EventLoop* events = nullptr;
+IngestPool* ingest = nullptr;
+Replayer* replay = nullptr;
+FeedViewer* viewer = nullptr; // Source for --view
+FeedPublisher* publisher = nullptr; // Sink for --publish
 TerminalGraph* graph = nullptr;
+HeadlessReport* report = nullptr; // Replaces the graph with --headless
+StateFile* state = nullptr; // Backs the graph's rings with --state
+KeyboardInput* keyboard = nullptr; // Keys for the graph's view, if stdin is a terminal
 
-void signalHandler(int signum) {
-    if (signum == SIGWINCH) {
-        // Terminal was resized
-        terminal_resized = true;
-    } else {
-        // SIGINT or SIGTERM
-        std::cout << "\nShutting down gracefully..." << std::endl;
-        running = false;
-        if (listener) {
-            listener->stop();
-        }
+// Samples handed from each receive thread to the UI thread
+const size_t QUEUE_CAPACITY = 1 << 16;
+
+// Upper bound on samples applied between two render checks
+const size_t MAX_DRAIN_PER_TICK = 1 << 18;
+
+// Options without a short form
+enum LongOption {
+    OPT_RECORD = 256,
+    OPT_REPLAY,
+    OPT_SPEED,
+    OPT_MAX,
+    OPT_STATS,
+    OPT_STATS_FILE,
+    OPT_STATS_INTERVAL,
+    OPT_BRAILLE,
+    OPT_HEATMAP,
+    OPT_HEADLESS,
+    OPT_REPORT_TO,
+    OPT_REPORT_INTERVAL,
+    OPT_REPORT_WINDOW,
+    OPT_STATE,
+    OPT_PUBLISH,
+    OPT_VIEW,
+    OPT_GRO
+};
+
+void cleanup() {
+    delete keyboard; // Puts the terminal back
+    keyboard = nullptr;
+    delete ingest; // Stops and joins the receive threads
+    ingest = nullptr;
+    delete replay;
+    replay = nullptr;
+    delete viewer;
+    viewer = nullptr;
+    delete publisher;
+    publisher = nullptr;
+    delete graph;
+    graph = nullptr;
+    delete report;
+    report = nullptr;
+    delete state; // After the graph, whose rings point into it
+    state = nullptr;
+    delete events;
+    events = nullptr;
+}
+
+// The earlier of two deadlines in nanoseconds, where negative means none
+long long earliest(long long a, long long b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    return std::min(a, b);
+}
+
+// Status line summary of everything lost on the way in, empty if nothing was
+std::string lossStatus(unsigned long long queue_drops, const LossCounts& loss) {
+    std::ostringstream out;
+    if (queue_drops > 0) {
+        out << " Dropped:" << queue_drops;
     }
+    if (loss.kernel_drops > 0) {
+        out << " Kernel:" << loss.kernel_drops;
+    }
+    if (loss.truncated > 0) {
+        out << " Trunc:" << loss.truncated;
+    }
+    if (loss.lost > 0) {
+        out << " Lost:" << loss.lost << " (" << std::fixed << std::setprecision(2) << loss.lossPercent() << "%)";
+    }
+    if (loss.reordered > 0) {
+        out << " Reord:" << loss.reordered;
+    }
+    if (loss.duplicates > 0) {
+        out << " Dup:" << loss.duplicates;
+    }
+    std::string status = out.str();
+    return status.empty() ? status : status.substr(1);
+}
+
+// Apply a key to the graph's view; false for quit
+bool handleKey(int key) {
+    switch (key) {
+        case ' ':
+        case 'p':
+            graph->togglePause();
+            break;
+        case '+':
+        case '=':
+        case KeyboardInput::KEY_UP:
+            graph->zoom(0.5);
+            break;
+        case '-':
+        case KeyboardInput::KEY_DOWN:
+            graph->zoom(2);
+            break;
+        case 'h':
+        case KeyboardInput::KEY_LEFT:
+            graph->pan(-0.25);
+            break;
+        case 'l':
+        case KeyboardInput::KEY_RIGHT:
+            graph->pan(0.25);
+            break;
+        case 'r':
+        case KeyboardInput::KEY_ESCAPE:
+            graph->resetView();
+            break;
+        case 'q':
+            return false;
+    }
+    return true;
+}
+
+// Parse a byte count with an optional K or M suffix; 0 if invalid
+int parseBytes(const char* text) {
+    char* end;
+    long value = std::strtol(text, &end, 10);
+    if (*end == 'K' || *end == 'k') {
+        value *= 1024;
+        ++end;
+    } else if (*end == 'M' || *end == 'm') {
+        value *= 1024 * 1024;
+        ++end;
+    }
+    return *end == '\0' && value > 0 && value <= (1L << 30) ? (int)value : 0;
 }
 
 // Function to get terminal size using ioctl
@@ -50,7 +181,49 @@ void printUsage(const char* program_name) {
               << "Options:\n"
               << "  -p PORT    UDP port to listen on (default: 4322)\n"
               << "  -m MINUTES Graph width in minutes of data (default: auto-detect)\n"
-              << "  -h         Show this help message\n"
+              << "  -r FPS     Maximum redraw rate in frames per second (default: 30)\n"
+              << "  -o POLICY  When the display falls behind: drop (oldest samples, default)\n"
+              << "             or block (stop reading the socket until it catches up)\n"
+              << "  -j N       Receive on N sockets sharing the port (SO_REUSEPORT), one\n"
+              << "             thread each; the kernel spreads senders across them\n"
+              << "  -c CPU     Pin receive thread i to CPU+i\n"
+              << "  -b BYTES   Socket receive buffer per receive thread, e.g. 8M (default:\n"
+              << "             the system's); warns if the kernel grants less\n"
+              << "  --gro          Let the kernel coalesce each sender's datagrams into one\n"
+              << "                 receive (UDP_GRO), fewer syscalls at high packet rates\n"
+              << "  --braille      Draw line plots with Braille dots: 2x the columns and 4x\n"
+              << "                 the rows of the block glyphs at the same output size\n"
+              << "  --heatmap      Color each time/value cell by how many samples fell in\n"
+              << "                 it, to show the distribution (implies -m 1 if -m is not given)\n"
+              << "  --state FILE   Keep the -m window in FILE (memory-mapped) so a restarted\n"
+              << "                 monitor shows it again immediately\n"
+              << "  --publish NAME Only receive and parse; share the samples in POSIX shared\n"
+              << "                 memory NAME for any number of --view processes\n"
+              << "  --view NAME    Graph the samples published as NAME instead of listening\n"
+              << "  --record FILE  Append every received datagram to a traffic log\n"
+              << "  --replay FILE  Graph a recorded traffic log instead of listening\n"
+              << "  --speed X      Replay at X times the recorded pace (default: 1)\n"
+              << "  --max          Replay as fast as possible, then exit and report\n"
+              << "                 the throughput\n"
+              << "  --stats        Show pipeline stats (rates, parse/update/render times,\n"
+              << "                 bytes per frame) on the bottom row\n"
+              << "  --stats-file FILE  Append the pipeline stats to FILE every interval\n"
+              << "  --stats-interval SECONDS  Stats interval (default: 1)\n"
+              << "  --headless     Do not draw; print per-channel count/min/max/mean and\n"
+              << "                 p50/p90/p99/p99.9 lines every interval instead\n"
+              << "  --report-to DEST  Where --headless lines go: - (stdout, default),\n"
+              << "                 udp:HOST:PORT or unix:PATH (one datagram per line)\n"
+              << "  --report-interval SECONDS  Time between report lines (default: 1)\n"
+              << "  --report-window SECONDS    Values covered by each line (default: the\n"
+              << "                 interval), rounded to whole intervals, at most 1000\n"
+              << "  -h, --help     Show this help message\n"
+              << "\nKeys (while graphing):\n"
+              << "  space, p       Pause/resume; data keeps being received while paused\n"
+              << "  + or Up        Zoom in (half the time span)\n"
+              << "  - or Down      Zoom out (twice the span, up to 48 hours)\n"
+              << "  Left/Right, h/l  Pan by a quarter of the span (pauses)\n"
+              << "  r, Esc         Back to the live view\n"
+              << "  q              Quit\n"
               << "\nGraph Display:\n"
               << "  Terminal size is auto-detected (minimum 80x20)\n"
               << "  Graph width can be specified in minutes for time-based data\n"
@@ -58,16 +231,70 @@ void printUsage(const char* program_name) {
               << "\nData Format:\n"
               << "  Send numeric values as plain text over UDP\n"
               << "  Multiple values can be sent separated by newlines or spaces\n"
-              << "  Example: echo \"42.5\" | nc -u localhost 4322\n";
+              << "  Example: echo \"42.5\" | nc -u localhost 4322\n"
+              << "  Tag values with a channel name to graph several series in stacked panes\n"
+              << "  Example: echo \"voltage=12.1 current=0.4 power=4.8\" | nc -u localhost 4322\n"
+              << "  Binary datagrams (packed float32/float64, see wire_format.h) are\n"
+              << "  detected automatically\n"
+              << "  Values are timestamped by the kernel on arrival. Senders that batch\n"
+              << "  values can add @t=SECONDS (epoch time of each channel's first value)\n"
+              << "  and/or @dt=SECONDS (spacing between a channel's values)\n"
+              << "  Example: echo \"@dt=0.01 1.0 1.2 1.1 0.9\" | nc -u localhost 4322\n"
+              << "  Senders can number their datagrams with @seq=N (per sender address and\n"
+              << "  port) to have gaps, reordering and duplicates counted on the status line\n";
 }
 
 int main(int argc, char* argv[]) {
     int port = 4322;
     int minutes = 0; // 0 means auto-detect based on terminal width
+    int max_fps = RenderScheduler::DEFAULT_MAX_FPS;
+    OverflowPolicy overflow = OverflowPolicy::DROP_OLDEST;
+    int shards = 1;
+    int first_cpu = -1;
+    int receive_buffer = 0; // System default
+    bool gro = false;
+    std::string record_path;
+    std::string replay_path;
+    double replay_speed = 1.0;
+    bool speed_given = false;
+    bool show_stats = false;
+    std::string stats_path;
+    double stats_interval = PipelineStats::DEFAULT_INTERVAL_MS / 1000.0;
+    PlotStyle plot_style = PlotStyle::BLOCKS;
+    std::string state_path;
+    std::string publish_name;
+    std::string view_name;
+    bool headless = false;
+    bool report_options = false;
+    std::string report_destination;
+    double report_interval = HeadlessReport::DEFAULT_INTERVAL_MS / 1000.0;
+    double report_window = 0; // 0 = one interval
+    
+    static const struct option long_options[] = {
+        { "record", required_argument, nullptr, OPT_RECORD },
+        { "replay", required_argument, nullptr, OPT_REPLAY },
+        { "speed",  required_argument, nullptr, OPT_SPEED },
+        { "max",    no_argument,       nullptr, OPT_MAX },
+        { "stats",  no_argument,       nullptr, OPT_STATS },
+        { "stats-file", required_argument, nullptr, OPT_STATS_FILE },
+        { "stats-interval", required_argument, nullptr, OPT_STATS_INTERVAL },
+        { "braille", no_argument,      nullptr, OPT_BRAILLE },
+        { "heatmap", no_argument,      nullptr, OPT_HEATMAP },
+        { "headless", no_argument,     nullptr, OPT_HEADLESS },
+        { "report-to", required_argument, nullptr, OPT_REPORT_TO },
+        { "report-interval", required_argument, nullptr, OPT_REPORT_INTERVAL },
+        { "report-window", required_argument, nullptr, OPT_REPORT_WINDOW },
+        { "state", required_argument,  nullptr, OPT_STATE },
+        { "publish", required_argument, nullptr, OPT_PUBLISH },
+        { "view",   required_argument, nullptr, OPT_VIEW },
+        { "gro",    no_argument,       nullptr, OPT_GRO },
+        { "help",   no_argument,       nullptr, 'h' },
+        { nullptr,  0,                 nullptr, 0 }
+    };
     
     // Parse command line arguments
     int opt;
-    while ((opt = getopt(argc, argv, "p:m:h")) != -1) {
+    while ((opt = getopt_long(argc, argv, "p:m:r:o:j:c:b:h", long_options, nullptr)) != -1) {
         switch (opt) {
             case 'p':
                 port = std::atoi(optarg);
@@ -83,6 +310,119 @@ int main(int argc, char* argv[]) {
                     return 1;
                 }
                 break;
+            case 'r':
+                max_fps = std::atoi(optarg);
+                if (max_fps <= 0) {
+                    std::cerr << "Error: Frame rate must be a positive number." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'o':
+                if (std::strcmp(optarg, "drop") == 0) {
+                    overflow = OverflowPolicy::DROP_OLDEST;
+                } else if (std::strcmp(optarg, "block") == 0) {
+                    overflow = OverflowPolicy::BLOCK;
+                } else {
+                    std::cerr << "Error: Overflow policy must be 'drop' or 'block'." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'j':
+                shards = std::atoi(optarg);
+                if (shards <= 0 || shards > 64) {
+                    std::cerr << "Error: Receive threads must be between 1 and 64." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'c':
+                first_cpu = std::atoi(optarg);
+                if (first_cpu < 0) {
+                    std::cerr << "Error: CPU must be a non-negative number." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'b':
+                receive_buffer = parseBytes(optarg);
+                if (receive_buffer == 0) {
+                    std::cerr << "Error: Receive buffer must be a positive size in bytes (K or M suffix allowed)."
+                              << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_GRO:
+                gro = true;
+                break;
+            case OPT_RECORD:
+                record_path = optarg;
+                break;
+            case OPT_REPLAY:
+                replay_path = optarg;
+                break;
+            case OPT_SPEED:
+                replay_speed = std::atof(optarg);
+                speed_given = true;
+                if (replay_speed <= 0) {
+                    std::cerr << "Error: Replay speed must be a positive number." << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_MAX:
+                replay_speed = 0; // As fast as possible
+                speed_given = true;
+                break;
+            case OPT_STATS:
+                show_stats = true;
+                break;
+            case OPT_STATS_FILE:
+                stats_path = optarg;
+                break;
+            case OPT_STATS_INTERVAL:
+                stats_interval = std::atof(optarg);
+                if (stats_interval < 0.1) {
+                    std::cerr << "Error: Stats interval must be at least 0.1 seconds." << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_BRAILLE:
+            case OPT_HEATMAP:
+                if (plot_style != PlotStyle::BLOCKS) {
+                    std::cerr << "Error: --braille and --heatmap cannot be combined." << std::endl;
+                    return 1;
+                }
+                plot_style = opt == OPT_BRAILLE ? PlotStyle::BRAILLE : PlotStyle::HEATMAP;
+                break;
+            case OPT_STATE:
+                state_path = optarg;
+                break;
+            case OPT_PUBLISH:
+                publish_name = optarg;
+                break;
+            case OPT_VIEW:
+                view_name = optarg;
+                break;
+            case OPT_HEADLESS:
+                headless = true;
+                break;
+            case OPT_REPORT_TO:
+                report_destination = optarg;
+                report_options = true;
+                break;
+            case OPT_REPORT_INTERVAL:
+                report_interval = std::atof(optarg);
+                report_options = true;
+                if (report_interval < 0.01) {
+                    std::cerr << "Error: Report interval must be at least 0.01 seconds." << std::endl;
+                    return 1;
+                }
+                break;
+            case OPT_REPORT_WINDOW:
+                report_window = std::atof(optarg);
+                report_options = true;
+                if (report_window <= 0) {
+                    std::cerr << "Error: Report window must be a positive number." << std::endl;
+                    return 1;
+                }
+                break;
             case 'h':
                 printUsage(argv[0]);
                 return 0;
@@ -93,82 +433,345 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    // Set up signal handlers for graceful shutdown and terminal resize
-    signal(SIGINT, signalHandler);
-    signal(SIGTERM, signalHandler);
-    signal(SIGWINCH, signalHandler);
+    if (speed_given && replay_path.empty()) {
+        std::cerr << "Error: --speed and --max only apply to --replay." << std::endl;
+        return 1;
+    }
+    if (!record_path.empty() && !replay_path.empty()) {
+        std::cerr << "Error: --record and --replay cannot be combined." << std::endl;
+        return 1;
+    }
+    if (!view_name.empty() && (!publish_name.empty() || !replay_path.empty() || !record_path.empty())) {
+        std::cerr << "Error: --view cannot be combined with --publish, --replay or --record." << std::endl;
+        return 1;
+    }
+    if (!publish_name.empty() && (headless || !state_path.empty() || show_stats)) {
+        std::cerr << "Error: --publish does not draw; --headless, --state and --stats belong on the viewers."
+                  << std::endl;
+        return 1;
+    }
+    if (plot_style == PlotStyle::HEATMAP && minutes == 0) {
+        minutes = 1; // Heatmap columns are time buckets
+    }
+    if (!state_path.empty() && (minutes == 0 || headless || !replay_path.empty())) {
+        std::cerr << "Error: --state needs -m and cannot be combined with --headless or --replay." << std::endl;
+        return 1;
+    }
+    if (report_options && !headless) {
+        std::cerr << "Error: --report-to, --report-interval and --report-window only apply to --headless."
+                  << std::endl;
+        return 1;
+    }
+    if (report_window / report_interval + 0.5 > HeadlessReport::MAX_WINDOW_INTERVALS) {
+        std::cerr << "Error: --report-window may span at most " << HeadlessReport::MAX_WINDOW_INTERVALS
+                  << " report intervals." << std::endl;
+        return 1;
+    }
+    if (headless && show_stats) {
+        std::cerr << "Error: --stats draws on the graph; use --stats-file with --headless." << std::endl;
+        return 1;
+    }
     
     try {
+        // Ctrl+C, SIGTERM and resizes arrive through the event loop. It
+        // blocks those signals, so it must exist before any thread starts.
+        events = new EventLoop();
+        Wakeup& wakeup = events->getWakeup();
+        
         // Get terminal size
         int term_width, term_height;
         getTerminalSize(term_width, term_height);
         
-        // Initialize components
-        listener = new UDPListener(port);
-        graph = new TerminalGraph(term_width, term_height, minutes);
-        DataParser parser;
+        // Initialize components; samples come from the socket, a traffic log
+        // or another process's feed
+        if (!view_name.empty()) {
+            viewer = new FeedViewer(view_name);
+        } else if (replay_path.empty()) {
+            ingest = new IngestPool(port, shards, QUEUE_CAPACITY, overflow, first_cpu, record_path, receive_buffer, gro);
+            ingest->setWakeup(&wakeup);
+        } else {
+            replay = new Replayer(replay_path, replay_speed);
+        }
+        const ChannelRegistry& channels = ingest ? ingest->getChannels()
+                                        : viewer ? viewer->getChannels() : replay->getChannels();
+        if (!publish_name.empty()) {
+            publisher = new FeedPublisher(publish_name, &channels); // Instead of drawing
+        } else if (headless) {
+            int interval_ms = (int)(report_interval * 1000);
+            size_t window_intervals = report_window > 0 ? (size_t)(report_window / report_interval + 0.5) : 1;
+            report = new HeadlessReport(report_destination, interval_ms, window_intervals, &channels);
+        } else {
+            graph = new TerminalGraph(term_width, term_height, minutes, &channels);
+            graph->setPlotStyle(plot_style);
+        }
+        if (!state_path.empty()) {
+            // Saved channels must get their old ids back before any datagram
+            // can register a name
+            state = new StateFile(state_path);
+            state->restoreChannels(ingest ? ingest->getChannels() : viewer->getChannels());
+            graph->attachState(state);
+        }
+        std::vector<Sample> samples; // Drain buffer, reused every tick
+        std::vector<int> keys;
+        RenderScheduler scheduler(max_fps);
+        if (state) {
+            scheduler.markDirty(); // Show the restored window before data arrives
+        }
+        unsigned long long shown_drops = 0;
+        LossCounts shown_loss;
+        unsigned long long shown_missed = 0;
+        
+        // Stage timing is only taken when someone looks at it
+        bool instrumented = show_stats || !stats_path.empty();
+        PipelineStats stats(stats_path, (int)(stats_interval * 1000));
+        HistogramSnapshot parse_timings;
+        if (ingest) {
+            ingest->setInstrumented(instrumented);
+        } else if (replay) {
+            replay->setInstrumented(instrumented);
+        }
+        
+        // Headless reports may go to stdout, so messages move to stderr
+        std::ostream& console = headless ? std::cerr : std::cout;
+        if (replay) {
+            console << "UDP Graph Monitor replaying " << replay_path << " ("
+                    << replay->getRecordCount() << " datagrams)" << std::endl;
+        } else if (viewer) {
+            console << "UDP Graph Monitor viewing feed " << view_name << std::endl;
+        } else {
+            console << "UDP Graph Monitor starting on port " << port << std::endl;
+        }
+        if (publisher) {
+            console << "Publishing to feed " << publish_name << std::endl;
+        }
+        if (shards > 1 && ingest) {
+            console << "Receive threads: " << shards << std::endl;
+        }
+        if (gro && ingest && !ingest->isGroEnabled()) {
+            std::cerr << "Warning: this kernel does not support UDP_GRO; receiving datagrams one by one"
+                      << std::endl;
+        }
+        if (receive_buffer > 0 && ingest) {
+            // Silently getting less would make the drop counts misleading
+            int granted = ingest->getReceiveBuffer();
+            if (granted < receive_buffer) {
+                std::cerr << "Warning: the kernel limited the receive buffer to " << granted << " of "
+                          << receive_buffer << " bytes; raise net.core.rmem_max to allow more" << std::endl;
+            } else {
+                console << "Receive buffer: " << granted << " bytes" << std::endl;
+            }
+        }
+        if (!record_path.empty()) {
+            console << "Recording to " << record_path << std::endl;
+        }
+        if (state) {
+            console << (state->wasRestored() ? "Restored " : "Started ") << state_path << " ("
+                    << graph->getDataPointCount() << " points in the window)" << std::endl;
+        }
+        if (headless) {
+            console << "Headless, reporting every " << report_interval << "s" << std::endl;
+        } else if (graph) {
+            if (minutes > 0) {
+                console << "Time window: " << minutes << " minutes" << std::endl;
+            }
+            console << "Terminal size: " << term_width << "x" << term_height << std::endl;
+        }
+        if (graph && isatty(STDIN_FILENO)) {
+            keyboard = new KeyboardInput(STDIN_FILENO);
+            events->watchInput(STDIN_FILENO);
+            console << "Space pauses, +/- zoom, arrows pan, r returns to live, q quits" << std::endl;
+        }
+        console << "Press Ctrl+C to exit\n" << std::endl;
         
-        std::cout << "UDP Graph Monitor starting on port " << port << std::endl;
-        if (minutes > 0) {
-            std::cout << "Time window: " << minutes << " minutes" << std::endl;
+        if (graph) {
+            // Clear screen and hide cursor
+            std::cout << "\033[2J\033[H\033[?25l";
+            std::cout.flush();
         }
-        std::cout << "Terminal size: " << term_width << "x" << term_height << std::endl;
-        std::cout << "Press Ctrl+C to exit\n" << std::endl;
         
-        // Clear screen and hide cursor
-        std::cout << "\033[2J\033[H\033[?25l";
-        std::cout.flush();
+        if (ingest) {
+            ingest->start();
+        } else if (replay) {
+            replay->start();
+        }
+        long long replay_start = currentTimeMs();
+        bool replay_reported = false;
         
-        // Main event loop
+        // Main event loop: drain the queues and redraw, the receive threads do the rest
+        bool running = true;
+        bool terminal_resized = false;
         while (running) {
+            if (ingest) {
+                ingest->checkFailures();
+            }
+            
             // Check if terminal was resized
-            if (terminal_resized) {
+            if (terminal_resized && graph) {
                 int new_width, new_height;
                 getTerminalSize(new_width, new_height);
                 graph->updateTerminalSize(new_width, new_height);
                 terminal_resized = false;
                 
-                // Force a redraw
-                std::cout << "\033[2J\033[H"; // Clear screen and move to top
+                // Redraw the whole screen immediately
                 if (graph->getDataPointCount() > 0) {
-                    graph->render();
-                    std::cout.flush();
+                    scheduler.forceRedraw();
                 }
             }
             
-            std::string data = listener->receiveData(1000); // 1 second timeout
+            // Anything queued from here on wakes the wait below
+            wakeup.arm();
             
-            if (!data.empty()) {
-                std::vector<double> values = parser.parseData(data);
-                
-                for (double value : values) {
-                    graph->addDataPoint(value);
+            size_t drained = 0;
+            while (drained < MAX_DRAIN_PER_TICK) {
+                samples.clear();
+                size_t count = ingest ? ingest->drain(samples)
+                             : viewer ? viewer->drain(samples, IngestPool::DRAIN_BATCH)
+                                      : replay->drain(samples, IngestPool::DRAIN_BATCH);
+                if (count == 0) {
+                    break;
                 }
-                
-                if (!values.empty()) {
-                    // Move cursor to top and redraw graph
-                    std::cout << "\033[H";
-                    graph->render();
-                    std::cout.flush();
+                uint64_t update_start = instrumented ? monotonicNanos() : 0;
+                if (publisher) {
+                    publisher->publish(samples);
+                } else if (report) {
+                    for (const Sample& sample : samples) {
+                        report->add(sample.value, sample.channel);
+                    }
+                } else {
+                    for (const Sample& sample : samples) {
+                        graph->addDataPoint(sample.value, sample.channel, sample.timestamp_ns);
+                    }
+                }
+                if (instrumented) {
+                    stats.recordUpdate(monotonicNanos() - update_start, count);
+                }
+                drained += count;
+                scheduler.markDirty();
+            }
+            
+            if (!graph) {
+                if (report) {
+                    report->tick();
+                }
+                replay_reported = replay && replay->finished();
+            } else if (viewer) {
+                unsigned long long missed = viewer->getMissedCount();
+                if (missed != shown_missed) {
+                    shown_missed = missed;
+                    graph->setStatusText("Missed:" + std::to_string(missed));
+                    scheduler.markDirty();
+                }
+            } else if (ingest) {
+                unsigned long long drops = ingest->getDroppedCount();
+                LossCounts loss = ingest->getLossCounts();
+                if (drops != shown_drops || loss != shown_loss) {
+                    shown_drops = drops;
+                    shown_loss = loss;
+                    graph->setStatusText(lossStatus(drops, loss));
+                    scheduler.markDirty();
+                }
+            } else if (replay->finished() && !replay_reported) {
+                replay_reported = true;
+                std::string loss = lossStatus(0, replay->getLossCounts());
+                graph->setStatusText(loss.empty() ? "Replay done" : "Replay done " + loss);
+                scheduler.forceRedraw();
+            }
+            
+            if (instrumented) {
+                parse_timings.reset();
+                bool updated;
+                if (ingest) {
+                    ingest->getParseHistogram(parse_timings);
+                    updated = stats.tick(ingest->getDatagramCount(), ingest->getValueCount(), parse_timings,
+                                         ingest->getDroppedCount(), ingest->getLossCounts());
+                } else if (viewer) {
+                    // Parsing happened in the publisher
+                    updated = stats.tick(0, viewer->getSampleCount(), parse_timings, viewer->getMissedCount());
+                } else {
+                    replay->getParseHistogram().addTo(parse_timings);
+                    updated = stats.tick(replay->getDatagramCount(), replay->getSampleCount(), parse_timings, 0,
+                                         replay->getLossCounts());
+                }
+                if (updated && show_stats) {
+                    graph->setFooterText(stats.getLine());
+                    scheduler.markDirty();
+                }
+            }
+            
+            // Redraw at most once per frame tick, independent of the ingest rate
+            if (graph && scheduler.shouldRender()) {
+                uint64_t render_start = instrumented ? monotonicNanos() : 0;
+                graph->render();
+                if (instrumented) {
+                    stats.recordRender(monotonicNanos() - render_start, graph->getLastFrameBytes());
+                }
+                scheduler.frameRendered();
+            }
+            
+            // An unpaced replay is a benchmark run: stop once the log is exhausted
+            bool unpaced = replay && replay->getSpeed() == 0;
+            if (unpaced && replay_reported && (!graph || !scheduler.shouldRender())) {
+                break;
+            }
+            
+            // Sleep until the next deadline. New samples and signals end the
+            // wait early, so with nothing pending this sleeps indefinitely.
+            long long timeout_ns = report ? report->nanosUntilTick() : graph ? scheduler.nanosUntilNextFrame() : -1;
+            if (drained >= MAX_DRAIN_PER_TICK) {
+                timeout_ns = 0; // The queues are still backed up
+            }
+            if (replay) {
+                timeout_ns = earliest(timeout_ns, replay->nanosUntilDue());
+            } else if (ingest) {
+                timeout_ns = earliest(timeout_ns, ingest->nanosUntilDue()); // Samples held for the merge
+            }
+            if (viewer) {
+                // Publishers cannot wake viewers, so look for new samples every frame
+                timeout_ns = earliest(timeout_ns, 1000000000LL / max_fps);
+            }
+            if (instrumented) {
+                timeout_ns = earliest(timeout_ns, stats.nanosUntilTick());
+            }
+            EventLoop::Events fired = events->wait(timeout_ns);
+            if (fired.interrupted) {
+                running = false;
+            }
+            if (fired.resized) {
+                terminal_resized = true;
+            }
+            if (fired.input && keyboard) {
+                keys.clear();
+                keyboard->read(keys);
+                for (int key : keys) {
+                    running = running && handleKey(key);
                 }
+                scheduler.forceRedraw(); // Answer keys without waiting for a frame tick
             }
         }
         
         // Restore cursor and clean up
-        std::cout << "\033[?25h" << std::endl;
-        delete listener;
-        delete graph;
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        if (listener) {
-            delete listener;
+        if (report) {
+            report->flush(); // The partial interval
+        } else if (graph) {
+            std::cout << "\033[?25h" << std::endl;
         }
-        if (graph) {
-            delete graph;
+        if (replay) {
+            double seconds = std::max(1LL, currentTimeMs() - replay_start) / 1000.0;
+            console << "Replayed " << replay->getDatagramCount() << " datagrams, "
+                      << replay->getSampleCount() << " values in " << std::fixed << std::setprecision(3)
+                      << seconds << "s (" << std::setprecision(0)
+                      << replay->getSampleCount() / seconds << " values/s)" << std::endl;
         }
+        console << "Shutting down gracefully..." << std::endl;
+        cleanup();
+        
+    } catch (const std::exception& e) {
+        cleanup();
         // Restore cursor
-        std::cout << "\033[?25h" << std::endl;
+        if (!headless) {
+            std::cout << "\033[?25h" << std::endl;
+        }
+        std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
     
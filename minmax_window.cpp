@@ -0,0 +1,55 @@
+#include "minmax_window.h"
+
+MinMaxWindow::MinMaxWindow(size_t capacity) : next_seq(0), front_seq(0) {
+    reset(capacity);
+}
+
+void MinMaxWindow::push(double value) {
+    if (min_deque.entries.empty()) {
+        return;
+    }
+    if (size() == min_deque.entries.size()) {
+        // Window is full, behave like the ring and evict the oldest sample
+        popFront();
+    }
+    
+    Entry entry = { next_seq++, value };
+    
+    // Anything larger than the new value can never be the minimum again
+    while (min_deque.count > 0 && min_deque.back().value >= value) {
+        min_deque.popBack();
+    }
+    min_deque.pushBack(entry);
+    
+    // Anything smaller than the new value can never be the maximum again
+    while (max_deque.count > 0 && max_deque.back().value <= value) {
+        max_deque.popBack();
+    }
+    max_deque.pushBack(entry);
+}
+
+void MinMaxWindow::popFront() {
+    if (empty()) {
+        return;
+    }
+    
+    if (min_deque.front().seq == front_seq) {
+        min_deque.popFront();
+    }
+    if (max_deque.front().seq == front_seq) {
+        max_deque.popFront();
+    }
+    ++front_seq;
+}
+
+void MinMaxWindow::clear() {
+    min_deque.head = min_deque.count = 0;
+    max_deque.head = max_deque.count = 0;
+    next_seq = front_seq = 0;
+}
+
+void MinMaxWindow::reset(size_t capacity) {
+    min_deque.entries.assign(capacity, Entry());
+    max_deque.entries.assign(capacity, Entry());
+    clear();
+}
@@ -0,0 +1,58 @@
+#ifndef MINMAX_WINDOW_H
+#define MINMAX_WINDOW_H
+
+#include <vector>
+#include <cstddef>
+
+// Tracks the minimum and maximum of a sliding FIFO window in O(1) amortized
+// time per operation using two monotonic deques. Samples are pushed at the
+// back and removed from the front in the same order as the series they
+// shadow, so push()/popFront() must mirror the owning SampleRing.
+class MinMaxWindow {
+private:
+    struct Entry {
+        unsigned long long seq;
+        double value;
+    };
+    
+    // Bounded deque stored in a ring; never holds more than capacity entries
+    struct MonotonicDeque {
+        std::vector<Entry> entries;
+        size_t head;
+        size_t count;
+        
+        MonotonicDeque() : head(0), count(0) {}
+        size_t slot(size_t index) const {
+            size_t i = head + index;
+            return i >= entries.size() ? i - entries.size() : i;
+        }
+        Entry& front() { return entries[head]; }
+        const Entry& front() const { return entries[head]; }
+        Entry& back() { return entries[slot(count - 1)]; }
+        void pushBack(const Entry& e) { entries[slot(count)] = e; ++count; }
+        void popBack() { --count; }
+        void popFront() { head = slot(1); --count; }
+    };
+    
+    MonotonicDeque min_deque; // Values increasing from front to back
+    MonotonicDeque max_deque; // Values decreasing from front to back
+    unsigned long long next_seq;  // Sequence number of the next pushed sample
+    unsigned long long front_seq; // Sequence number of the oldest live sample
+    
+public:
+    explicit MinMaxWindow(size_t capacity = 0);
+    
+    void push(double value);
+    void popFront();
+    void clear();
+    
+    // Drop all state and size the deques for a new window capacity
+    void reset(size_t capacity);
+    
+    bool empty() const { return next_seq == front_seq; }
+    size_t size() const { return (size_t)(next_seq - front_seq); }
+    double min() const { return min_deque.front().value; }
+    double max() const { return max_deque.front().value; }
+};
+
+#endif // MINMAX_WINDOW_H
@@ -0,0 +1,175 @@
+#include "receiver.h"
+#include <cstring>
+#include <cerrno>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <stdexcept>
+
+const int Receiver::RECORD_FLUSH_MS;
+
+Receiver::Receiver(int port, SpscQueue<Sample>& output, ChannelRegistry& channels,
+                   bool reuse_port, int pin_cpu, TrafficRecorder* traffic_recorder, int receive_buffer, bool gro)
+    : listener(port, UDPListener::DEFAULT_BATCH_SIZE, reuse_port, receive_buffer, gro), parser(&channels), queue(output),
+      recorder(traffic_recorder), wakeup(nullptr), epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+      stop_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), running(false), datagram_count(0), value_count(0),
+      malformed_count(0), kernel_drops(0), truncated_count(0), sequenced_count(0), lost_count(0), reordered_count(0),
+      duplicate_count(0), failed(false), cpu(pin_cpu), instrumented(false) {
+    // Edge-triggered on the socket: each wakeup drains it to EAGAIN
+    struct epoll_event socket_event, stop_event;
+    std::memset(&socket_event, 0, sizeof(socket_event));
+    std::memset(&stop_event, 0, sizeof(stop_event));
+    socket_event.events = EPOLLIN | EPOLLET;
+    socket_event.data.fd = listener.getFd();
+    stop_event.events = EPOLLIN;
+    stop_event.data.fd = stop_fd;
+    
+    if (epoll_fd < 0 || stop_fd < 0 ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener.getFd(), &socket_event) < 0 ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &stop_event) < 0) {
+        std::string error = strerror(errno);
+        if (epoll_fd >= 0) close(epoll_fd);
+        if (stop_fd >= 0) close(stop_fd);
+        throw std::runtime_error("Failed to set up receive polling: " + error);
+    }
+}
+
+Receiver::~Receiver() {
+    stop();
+    close(epoll_fd);
+    close(stop_fd);
+}
+
+void Receiver::start() {
+    if (running) {
+        return;
+    }
+    running = true;
+    
+    // The new thread inherits the signal mask, so block signals around its creation
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    sigaddset(&blocked, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    thread = std::thread(&Receiver::run, this);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    
+    if (cpu >= 0) {
+        // Pinning is best effort; an unavailable CPU just leaves the thread floating
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+    }
+}
+
+void Receiver::stop() {
+    running = false;
+    uint64_t one = 1;
+    ssize_t written = write(stop_fd, &one, sizeof(one)); // Interrupt epoll_wait
+    (void)written;
+    queue.close(); // Release a push blocked on a full queue
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Receiver::run() {
+    try {
+        receiveLoop();
+    } catch (const std::exception& e) {
+        error_message = e.what();
+        failed.store(true, std::memory_order_release);
+        if (wakeup) {
+            wakeup->notify(); // So the UI thread notices promptly
+        }
+    }
+}
+
+void Receiver::receiveLoop() {
+    std::vector<Datagram> batch;
+    std::vector<Sample> samples; // Reused across datagrams to avoid allocations
+    
+    while (running.load(std::memory_order_relaxed)) {
+        // Sleep until the socket has data or stop() is called. Only buffered
+        // recordings need a timeout, to flush them while the socket is idle.
+        int timeout_ms = recorder && recorder->hasPending() ? RECORD_FLUSH_MS : -1;
+        struct epoll_event events[2];
+        int ready = epoll_wait(epoll_fd, events, 2, timeout_ms);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("epoll_wait failed: " + std::string(strerror(errno)));
+        }
+        if (ready == 0) {
+            recorder->flush();
+            continue;
+        }
+        
+        // Edge-triggered, so drain until the socket is empty, a full batch
+        // of datagrams per syscall
+        while (running.load(std::memory_order_relaxed) && listener.receiveReady(batch) > 0) {
+            // Fallback for datagrams the kernel did not timestamp
+            long long read_time = currentTimeNs();
+            datagram_count.fetch_add(batch.size(), std::memory_order_relaxed);
+            
+            size_t values = 0;
+            for (const Datagram& datagram : batch) {
+                long long receive_time = datagram.timestamp_ns > 0 ? datagram.timestamp_ns : read_time;
+                if (recorder) {
+                    recorder->record(datagram, receive_time);
+                }
+                samples.clear();
+                if (instrumented) {
+                    uint64_t parse_start = monotonicNanos();
+                    parser.parseInto(datagram.data, datagram.length, samples, receive_time);
+                    parse_ns.record(monotonicNanos() - parse_start);
+                } else {
+                    parser.parseInto(datagram.data, datagram.length, samples, receive_time);
+                }
+                values += samples.size();
+                
+                uint64_t sequence;
+                if (parser.getSequence(sequence)) {
+                    sequences.record(SequenceTracker::senderKey(datagram.sender), sequence);
+                }
+                
+                for (const Sample& sample : samples) {
+                    if (!queue.push(sample)) {
+                        return; // Closed while blocked on a full queue
+                    }
+                }
+            }
+            value_count.fetch_add(values, std::memory_order_relaxed);
+            malformed_count.store(parser.getMalformedCount(), std::memory_order_relaxed);
+            publishLoss();
+            if (wakeup) {
+                wakeup->notify();
+            }
+        }
+    }
+}
+
+void Receiver::publishLoss() {
+    const LossCounts& counts = sequences.getCounts();
+    kernel_drops.store(listener.getKernelDrops(), std::memory_order_relaxed);
+    truncated_count.store(listener.getTruncatedCount(), std::memory_order_relaxed);
+    sequenced_count.store(counts.sequenced, std::memory_order_relaxed);
+    lost_count.store(counts.lost, std::memory_order_relaxed);
+    reordered_count.store(counts.reordered, std::memory_order_relaxed);
+    duplicate_count.store(counts.duplicates, std::memory_order_relaxed);
+}
+
+void Receiver::getLossCounts(LossCounts& out) const {
+    out.kernel_drops += kernel_drops.load(std::memory_order_relaxed);
+    out.truncated += truncated_count.load(std::memory_order_relaxed);
+    out.sequenced += sequenced_count.load(std::memory_order_relaxed);
+    out.lost += lost_count.load(std::memory_order_relaxed);
+    out.reordered += reordered_count.load(std::memory_order_relaxed);
+    out.duplicates += duplicate_count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,96 @@
+#ifndef RECEIVER_H
+#define RECEIVER_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include "udp_listener.h"
+#include "data_parser.h"
+#include "spsc_queue.h"
+#include "traffic_log.h"
+#include "stats.h"
+#include "event_loop.h"
+#include "sequence_tracker.h"
+#include "sample.h"
+
+// Ingest side of the monitor: a dedicated thread that owns the UDP socket,
+// parses datagrams and hands samples to the UI thread through a bounded
+// lock-free queue, so a slow terminal never stalls the socket. The thread
+// sleeps in epoll until the socket becomes readable and then drains it
+// completely (edge-triggered), so an idle receiver never wakes up.
+class Receiver {
+private:
+    UDPListener listener;
+    DataParser parser;
+    SpscQueue<Sample>& queue;
+    TrafficRecorder* recorder; // Not owned, may be null
+    Wakeup* wakeup; // Notified after each batch, may be null
+    int epoll_fd;
+    int stop_fd; // eventfd that interrupts the wait on stop()
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<unsigned long long> datagram_count;
+    std::atomic<unsigned long long> value_count;
+    std::atomic<unsigned long long> malformed_count;
+    SequenceTracker sequences; // Receive thread only; published below after each batch
+    std::atomic<unsigned long long> kernel_drops;
+    std::atomic<unsigned long long> truncated_count;
+    std::atomic<unsigned long long> sequenced_count;
+    std::atomic<unsigned long long> lost_count;
+    std::atomic<unsigned long long> reordered_count;
+    std::atomic<unsigned long long> duplicate_count;
+    std::atomic<bool> failed;
+    int cpu; // CPU to pin the thread to, -1 for none
+    bool instrumented; // Time each parse into parse_ns
+    LatencyHistogram parse_ns;
+    std::string error_message; // Written before failed is set
+    
+    void run();
+    void receiveLoop();
+    void publishLoss();
+    
+public:
+    // How long recorded datagrams may stay buffered while the socket is idle
+    static const int RECORD_FLUSH_MS = 1000;
+    
+    // channels is shared by all receivers so they agree on channel ids.
+    // reuse_port lets several receivers share the port; cpu >= 0 pins the
+    // receive thread to that CPU. Every datagram is also appended to
+    // recorder if given, which only this receiver's thread may use.
+    // receive_buffer > 0 sets the socket receive buffer size in bytes, and
+    // gro asks the kernel for coalesced receives (UDP_GRO).
+    Receiver(int port, SpscQueue<Sample>& output, ChannelRegistry& channels,
+             bool reuse_port = false, int cpu = -1, TrafficRecorder* recorder = nullptr, int receive_buffer = 0,
+             bool gro = false);
+    ~Receiver();
+    
+    // Start the receive thread. Signals are blocked on it so the UI thread
+    // keeps handling SIGINT, SIGTERM and SIGWINCH.
+    void start();
+    
+    // Stop the receive thread and wait for it to exit
+    void stop();
+    
+    // Wake the UI thread after queueing samples; set before start()
+    void setWakeup(Wakeup* target) { wakeup = target; }
+    
+    // Time every parse into getParseHistogram(); set before start()
+    void setInstrumented(bool enabled) { instrumented = enabled; }
+    const LatencyHistogram& getParseHistogram() const { return parse_ns; }
+    
+    unsigned long long getMalformedCount() const { return malformed_count.load(std::memory_order_relaxed); }
+    // True if the thread stopped on an error; see getError()
+    bool hasFailed() const { return failed.load(std::memory_order_acquire); }
+    const std::string& getError() const { return error_message; }
+    
+    unsigned long long getDatagramCount() const { return datagram_count.load(std::memory_order_relaxed); }
+    unsigned long long getValueCount() const { return value_count.load(std::memory_order_relaxed); }
+    
+    // Add the kernel drop and sequence gap counters to out
+    void getLossCounts(LossCounts& out) const;
+    int getReceiveBuffer() const { return listener.getReceiveBuffer(); }
+    bool isGroEnabled() const { return listener.isGroEnabled(); }
+};
+
+#endif // RECEIVER_H
@@ -0,0 +1,52 @@
+#include "render_scheduler.h"
+#include <chrono>
+
+RenderScheduler::RenderScheduler(int max_fps)
+    : last_frame_time(0), dirty(false), forced(false) {
+    if (max_fps <= 0) {
+        max_fps = DEFAULT_MAX_FPS;
+    }
+    frame_interval_ns = 1000000000LL / max_fps;
+}
+
+long long RenderScheduler::getCurrentTimeNs() const {
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+}
+
+bool RenderScheduler::shouldRender() const {
+    if (forced) {
+        return true;
+    }
+    if (!dirty) {
+        return false;
+    }
+    return getCurrentTimeNs() - last_frame_time >= frame_interval_ns;
+}
+
+void RenderScheduler::frameRendered() {
+    last_frame_time = getCurrentTimeNs();
+    dirty = false;
+    forced = false;
+}
+
+int RenderScheduler::millisUntilNextFrame() const {
+    long long remaining = nanosUntilNextFrame();
+    if (remaining <= 0) {
+        return (int)remaining;
+    }
+    // Round up so we never wake just before the tick
+    return (int)((remaining + 999999) / 1000000);
+}
+
+long long RenderScheduler::nanosUntilNextFrame() const {
+    if (forced) {
+        return 0;
+    }
+    if (!dirty) {
+        return -1;
+    }
+    
+    long long remaining = last_frame_time + frame_interval_ns - getCurrentTimeNs();
+    return remaining > 0 ? remaining : 0;
+}
@@ -0,0 +1,42 @@
+#ifndef RENDER_SCHEDULER_H
+#define RENDER_SCHEDULER_H
+
+// Decides when the graph should be redrawn so that rendering is decoupled
+// from the ingest rate. New data only marks the frame dirty; a redraw happens
+// at most once per frame tick, or immediately when forced (e.g. on resize).
+class RenderScheduler {
+private:
+    long long frame_interval_ns;
+    long long last_frame_time;
+    bool dirty;
+    bool forced;
+    
+    long long getCurrentTimeNs() const;
+    
+public:
+    static const int DEFAULT_MAX_FPS = 30;
+    
+    RenderScheduler(int max_fps = DEFAULT_MAX_FPS);
+    
+    // Note that the displayed data changed
+    void markDirty() { dirty = true; }
+    
+    // Request a redraw on the next check regardless of the frame tick
+    void forceRedraw() { forced = true; }
+    
+    // True if a frame should be drawn now
+    bool shouldRender() const;
+    
+    // Record that a frame was just drawn
+    void frameRendered();
+    
+    // Milliseconds until a pending frame is due, or -1 if nothing is pending
+    int millisUntilNextFrame() const;
+    
+    // Same in nanoseconds, for timers with sub-millisecond resolution
+    long long nanosUntilNextFrame() const;
+    
+    int getMaxFps() const { return (int)(1000000000LL / frame_interval_ns); }
+};
+
+#endif // RENDER_SCHEDULER_H
@@ -0,0 +1,72 @@
+#include "replayer.h"
+
+Replayer::Replayer(const std::string& path, double replay_speed)
+    : log(path), speed(replay_speed), start_time(0), has_pending(false), done(false),
+      datagram_count(0), sample_count(0), instrumented(false) {
+}
+
+void Replayer::start() {
+    start_time = currentTimeNs();
+    log.rewind();
+    has_pending = false;
+    done = log.getRecordCount() == 0;
+}
+
+long long Replayer::nanosUntilDue() const {
+    if (done) {
+        return -1;
+    }
+    if (speed == 0 || !has_pending) {
+        return 0;
+    }
+    long long due = start_time + (long long)((pending.timestamp_ns - log.getFirstTimestamp()) / speed);
+    long long remaining = due - currentTimeNs();
+    return remaining > 0 ? remaining : 0;
+}
+
+size_t Replayer::drain(std::vector<Sample>& out, size_t max_samples) {
+    long long now = currentTimeNs();
+    size_t appended = 0;
+    
+    while (!done && appended < max_samples) {
+        if (!has_pending && !log.next(pending)) {
+            done = true;
+            break;
+        }
+        has_pending = true;
+        
+        long long timestamp;
+        if (speed > 0) {
+            // Paced: a record is due once its scaled offset has elapsed
+            timestamp = start_time + (long long)((pending.timestamp_ns - log.getFirstTimestamp()) / speed);
+            if (timestamp > now) {
+                break;
+            }
+        } else {
+            // Unpaced: keep the original spacing, ending at the start time
+            timestamp = pending.timestamp_ns + (start_time - log.getLastTimestamp());
+        }
+        
+        // Sender timestamps move with the record (exact when unpaced)
+        parser.setSenderTimeOffset(timestamp - pending.timestamp_ns);
+        
+        if (instrumented) {
+            uint64_t parse_start = monotonicNanos();
+            appended += parser.parseInto(pending.data, pending.length, out, timestamp);
+            parse_ns.record(monotonicNanos() - parse_start);
+        } else {
+            appended += parser.parseInto(pending.data, pending.length, out, timestamp);
+        }
+        has_pending = false;
+        ++datagram_count;
+        
+        // Gaps in a capture's sequence numbers were lost on the way to the recorder
+        uint64_t sequence;
+        if (parser.getSequence(sequence)) {
+            sequences.record(SequenceTracker::senderKey(pending.sender), sequence);
+        }
+    }
+    
+    sample_count += appended;
+    return appended;
+}
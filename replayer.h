@@ -0,0 +1,59 @@
+#ifndef REPLAYER_H
+#define REPLAYER_H
+
+#include <vector>
+#include <string>
+#include "traffic_log.h"
+#include "data_parser.h"
+#include "sample.h"
+#include "stats.h"
+#include "sequence_tracker.h"
+
+// Replay source for --replay: feeds a recorded traffic log through the same
+// parser as live traffic, either paced like the original capture (scaled by
+// speed) or as fast as the UI thread can take it. Samples are restamped so
+// the capture ends up in the graph's current time window.
+class Replayer {
+private:
+    TrafficLog log;
+    DataParser parser;
+    double speed; // 0 = as fast as possible
+    long long start_time;
+    LoggedDatagram pending; // Next record, read but not yet due
+    bool has_pending;
+    bool done;
+    unsigned long long datagram_count;
+    unsigned long long sample_count;
+    bool instrumented;
+    LatencyHistogram parse_ns;
+    SequenceTracker sequences;
+    
+public:
+    explicit Replayer(const std::string& path, double replay_speed = 1.0);
+    
+    // Start the replay clock
+    void start();
+    
+    // Parse the records that are due into out, stopping once at least
+    // max_samples were appended. Returns the number of samples appended.
+    size_t drain(std::vector<Sample>& out, size_t max_samples);
+    
+    // Nanoseconds until drain() has more to do: 0 when records are ready
+    // (always, unpaced), -1 once the log is exhausted
+    long long nanosUntilDue() const;
+    
+    // Time every parse into getParseHistogram()
+    void setInstrumented(bool enabled) { instrumented = enabled; }
+    const LatencyHistogram& getParseHistogram() const { return parse_ns; }
+    
+    bool finished() const { return done; }
+    double getSpeed() const { return speed; }
+    const ChannelRegistry& getChannels() const { return parser.getChannels(); }
+    size_t getRecordCount() const { return log.getRecordCount(); }
+    unsigned long long getDatagramCount() const { return datagram_count; }
+    unsigned long long getSampleCount() const { return sample_count; }
+    unsigned long long getMalformedCount() const { return parser.getMalformedCount(); }
+    const LossCounts& getLossCounts() const { return sequences.getCounts(); }
+};
+
+#endif // REPLAYER_H
@@ -0,0 +1,124 @@
+#include "rollup_tiers.h"
+#include <algorithm>
+#include <cmath>
+
+const int RollupTiers::TIER_COUNT;
+
+// 1 h of seconds, 6 h of 10 s, 48 h of minutes and 48 h of 10 min, about
+// 490 KiB per series
+const long long RollupTiers::TIER_NS[TIER_COUNT] = { 1000000000LL, 10000000000LL, 60000000000LL, 600000000000LL };
+const size_t RollupTiers::TIER_BUCKETS[TIER_COUNT] = { 3600, 2160, 2880, 288 };
+
+RollupTiers::RollupTiers() {
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        open_slot[tier] = 0;
+        open_end[tier] = 0;
+    }
+}
+
+void RollupTiers::add(long long timestamp_ns, double value) {
+    if (timestamp_ns < 0 || !std::isfinite(value)) {
+        return;
+    }
+    
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        std::vector<Bucket>& buckets = tiers[tier];
+        if (timestamp_ns >= open_end[tier]) {
+            // Past the open bucket, so find its slot and reuse it
+            if (buckets.empty()) {
+                Bucket unused;
+                unused.index = -1;
+                buckets.assign(TIER_BUCKETS[tier], unused);
+            }
+            long long index = timestamp_ns / TIER_NS[tier];
+            open_slot[tier] = (size_t)(index % (long long)buckets.size());
+            open_end[tier] = (index + 1) * TIER_NS[tier];
+            Bucket& bucket = buckets[open_slot[tier]];
+            bucket.index = index;
+            bucket.summary.reset();
+            bucket.sum = 0;
+        }
+        Bucket& bucket = buckets[open_slot[tier]];
+        bucket.summary.add(value);
+        bucket.sum += value;
+    }
+}
+
+void RollupTiers::clear() {
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        std::vector<Bucket>().swap(tiers[tier]);
+        open_slot[tier] = 0;
+        open_end[tier] = 0;
+    }
+}
+
+int RollupTiers::tierFor(long long column_ns) {
+    int tier = 0;
+    while (tier + 1 < TIER_COUNT && TIER_NS[tier + 1] <= column_ns) {
+        ++tier;
+    }
+    return tier;
+}
+
+void RollupTiers::bucketRange(int tier, long long from, long long to, long long& first, long long& last) {
+    first = std::max(0LL, from) / TIER_NS[tier];
+    last = (to - 1) / TIER_NS[tier];
+    first = std::max(first, last - (long long)TIER_BUCKETS[tier] + 1);
+}
+
+void RollupTiers::summarize(long long window_start, long long window_ns, long long until,
+                            ColumnSummary* columns, int column_count) const {
+    if (column_count <= 0 || window_ns <= 0) {
+        return;
+    }
+    int tier = tierFor(window_ns / column_count);
+    const std::vector<Bucket>& buckets = tiers[tier];
+    if (buckets.empty()) {
+        return;
+    }
+    
+    long long first, last;
+    bucketRange(tier, window_start, std::min(window_start + window_ns, until), first, last);
+    for (long long index = first; index <= last; ++index) {
+        const Bucket& bucket = buckets[(size_t)(index % (long long)buckets.size())];
+        if (bucket.index != index) {
+            continue; // No samples, or already reused by a newer bucket
+        }
+        long long offset = std::max(0LL, index * TIER_NS[tier] - window_start);
+        int col = std::min(column_count - 1, (int)(offset * column_count / window_ns));
+        columns[col].merge(bucket.summary);
+    }
+}
+
+bool RollupTiers::getMean(long long from, long long to, long long column_ns, double& mean) const {
+    int tier = tierFor(column_ns);
+    const std::vector<Bucket>& buckets = tiers[tier];
+    if (buckets.empty() || to <= from) {
+        return false;
+    }
+    
+    long long first, last;
+    bucketRange(tier, from, to, first, last);
+    double sum = 0;
+    size_t count = 0;
+    for (long long index = first; index <= last; ++index) {
+        const Bucket& bucket = buckets[(size_t)(index % (long long)buckets.size())];
+        if (bucket.index == index) {
+            sum += bucket.sum;
+            count += bucket.summary.count;
+        }
+    }
+    if (count == 0) {
+        return false;
+    }
+    mean = sum / count;
+    return true;
+}
+
+size_t RollupTiers::getBytes() const {
+    size_t bytes = 0;
+    for (const std::vector<Bucket>& buckets : tiers) {
+        bytes += buckets.size() * sizeof(Bucket);
+    }
+    return bytes;
+}
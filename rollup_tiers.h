@@ -0,0 +1,65 @@
+#ifndef ROLLUP_TIERS_H
+#define ROLLUP_TIERS_H
+
+#include <vector>
+#include <cstddef>
+#include "column_summary.h"
+
+// Multi-resolution summaries of one series for zooming out past the raw
+// points: rings of 1 s, 10 s, 1 min and 10 min buckets, each holding the
+// min, max, first, last, sum and count of the samples that fell into it.
+// Every sample updates one bucket per tier, O(1), and the coarsest tier
+// reaches back two days.
+//
+// Drawing picks the coarsest tier whose buckets are no wider than a screen
+// column. The next tier up is at most ten times coarser, so below the
+// coarsest tier a window costs under ten buckets per column; windows wide
+// enough for the coarsest tier read at most its 288 buckets.
+class RollupTiers {
+public:
+    static const int TIER_COUNT = 4;
+    static const long long TIER_NS[TIER_COUNT];      // Bucket width per tier, finest first
+    static const size_t TIER_BUCKETS[TIER_COUNT];    // Ring size per tier
+    
+private:
+    struct Bucket {
+        long long index; // Absolute bucket number held here, -1 if never used
+        ColumnSummary summary;
+        double sum;
+    };
+    
+    std::vector<Bucket> tiers[TIER_COUNT]; // Allocated on the first sample
+    size_t open_slot[TIER_COUNT];          // Bucket the last sample went to
+    long long open_end[TIER_COUNT];        // and where it ends, in ns
+    
+    // Bucket numbers of tier that start in [from, to), limited to its ring
+    static void bucketRange(int tier, long long from, long long to, long long& first, long long& last);
+    
+public:
+    RollupTiers();
+    
+    // Count a sample; timestamps must be non-decreasing
+    void add(long long timestamp_ns, double value);
+    
+    void clear();
+    
+    // Coarsest tier with buckets no wider than column_ns, or the finest
+    static int tierFor(long long column_ns);
+    
+    // Fold the buckets that start in the window and before until into
+    // column_count columns spanning window_ns, at the tier for the column
+    // width. A bucket lands in the column holding its start.
+    void summarize(long long window_start, long long window_ns, long long until,
+                   ColumnSummary* columns, int column_count) const;
+    
+    // Mean of the samples in [from, to) at the tier for column_ns; false if
+    // there are none
+    bool getMean(long long from, long long to, long long column_ns, double& mean) const;
+    
+    // How far back the coarsest tier reaches
+    static long long getRetentionNs() { return TIER_NS[TIER_COUNT - 1] * (long long)TIER_BUCKETS[TIER_COUNT - 1]; }
+    
+    size_t getBytes() const;
+};
+
+#endif // ROLLUP_TIERS_H
@@ -0,0 +1,28 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdint.h>
+#include <chrono>
+
+// A parsed value tagged with the channel it belongs to and when it was
+// taken: the sender's timestamp if it supplied one, else the receive time
+struct Sample {
+    long long timestamp_ns;
+    double value;
+    uint16_t channel;
+};
+
+// Wall clock time in milliseconds since the epoch
+inline long long currentTimeMs() {
+    auto now = std::chrono::system_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+}
+
+// Wall clock time in nanoseconds since the epoch, the same clock as kernel
+// receive timestamps; used to timestamp samples
+inline long long currentTimeNs() {
+    auto now = std::chrono::system_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+}
+
+#endif // SAMPLE_H
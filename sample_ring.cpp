@@ -0,0 +1,131 @@
+#include "sample_ring.h"
+
+SampleRing::SampleRing(size_t capacity)
+    : own_values(capacity), own_timestamps(capacity) {
+    own_cursor.head = 0;
+    own_cursor.count = 0;
+    useOwnStorage();
+}
+
+SampleRing::SampleRing(const SampleRing& other)
+    : own_values(other.own_values), own_timestamps(other.own_timestamps), own_cursor(other.own_cursor) {
+    useOwnStorage();
+    if (other.isAttached()) {
+        attach(other.values, other.timestamps, other.cursor, other.ring_capacity);
+    }
+}
+
+SampleRing& SampleRing::operator=(const SampleRing& other) {
+    if (this != &other) {
+        own_values = other.own_values;
+        own_timestamps = other.own_timestamps;
+        own_cursor = other.own_cursor;
+        useOwnStorage();
+        if (other.isAttached()) {
+            attach(other.values, other.timestamps, other.cursor, other.ring_capacity);
+        }
+    }
+    return *this;
+}
+
+void SampleRing::useOwnStorage() {
+    values = own_values.data();
+    timestamps = own_timestamps.data();
+    cursor = &own_cursor;
+    ring_capacity = own_values.size();
+}
+
+void SampleRing::attach(double* external_values, long long* external_timestamps, Cursor* external_cursor,
+                        size_t capacity) {
+    values = external_values;
+    timestamps = external_timestamps;
+    cursor = external_cursor;
+    ring_capacity = capacity;
+    
+    // Distrust a cursor that cannot be valid for this capacity
+    if (cursor->count > capacity || (capacity > 0 && cursor->head >= capacity)) {
+        cursor->head = 0;
+        cursor->count = 0;
+    }
+    
+    std::vector<double>().swap(own_values);
+    std::vector<long long>().swap(own_timestamps);
+}
+
+void SampleRing::push(double value, long long timestamp) {
+    if (ring_capacity == 0) {
+        return;
+    }
+    
+    if (cursor->count == ring_capacity) {
+        // Overwrite the oldest sample
+        values[cursor->head] = value;
+        timestamps[cursor->head] = timestamp;
+        cursor->head = slot(1);
+        return;
+    }
+    
+    size_t tail = slot(cursor->count);
+    values[tail] = value;
+    timestamps[tail] = timestamp;
+    ++cursor->count;
+}
+
+void SampleRing::popFront() {
+    if (cursor->count == 0) {
+        return;
+    }
+    cursor->head = slot(1);
+    --cursor->count;
+}
+
+void SampleRing::popFront(size_t n) {
+    if (n >= cursor->count) {
+        clear();
+        return;
+    }
+    cursor->head = slot(n);
+    cursor->count -= n;
+}
+
+void SampleRing::setCapacity(size_t capacity) {
+    if (capacity == ring_capacity || isAttached()) {
+        return;
+    }
+    
+    // Linearise the newest samples into fresh storage
+    size_t count = cursor->count;
+    size_t keep = count < capacity ? count : capacity;
+    std::vector<double> new_values(capacity);
+    std::vector<long long> new_timestamps(capacity);
+    for (size_t i = 0; i < keep; ++i) {
+        size_t src = slot(count - keep + i);
+        new_values[i] = values[src];
+        new_timestamps[i] = timestamps[src];
+    }
+    
+    own_values.swap(new_values);
+    own_timestamps.swap(new_timestamps);
+    own_cursor.head = 0;
+    own_cursor.count = keep;
+    useOwnStorage();
+}
+
+void SampleRing::clear() {
+    cursor->head = 0;
+    cursor->count = 0;
+}
+
+size_t SampleRing::lowerBound(long long timestamp) const {
+    size_t low = 0;
+    size_t high = cursor->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (timestamps[slot(mid)] < timestamp) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
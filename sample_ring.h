@@ -0,0 +1,86 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+// Fixed-capacity ring buffer holding a series as two parallel arrays
+// (values and timestamps). Pushing into a full ring overwrites the oldest
+// sample, so push and expiry are O(1). Index 0 is always the oldest sample.
+//
+// The arrays and cursor normally live in the ring itself, but attach() can
+// point them at external memory such as a mapped state file, so the ring
+// survives the process without any copying.
+class SampleRing {
+public:
+    // Where the samples are; kept with the arrays when they are external
+    struct Cursor {
+        uint64_t head;  // Physical slot of the oldest sample
+        uint64_t count;
+    };
+    
+private:
+    std::vector<double> own_values;
+    std::vector<long long> own_timestamps;
+    Cursor own_cursor;
+    
+    // Storage in use: the vectors above, or attached memory
+    double* values;
+    long long* timestamps;
+    Cursor* cursor;
+    size_t ring_capacity;
+    
+    size_t slot(size_t index) const {
+        size_t i = cursor->head + index;
+        return i >= ring_capacity ? i - ring_capacity : i;
+    }
+    void useOwnStorage();
+    
+public:
+    explicit SampleRing(size_t capacity = 0);
+    SampleRing(const SampleRing& other);
+    SampleRing& operator=(const SampleRing& other);
+    
+    // Use external storage for capacity samples, keeping whatever it holds.
+    // The memory must outlive the ring, and its capacity is then fixed:
+    // setCapacity() leaves an attached ring unchanged.
+    void attach(double* external_values, long long* external_timestamps, Cursor* external_cursor,
+                size_t capacity);
+    bool isAttached() const { return cursor != &own_cursor; }
+    
+    // Append a sample, evicting the oldest one if the ring is full
+    void push(double value, long long timestamp);
+    
+    // Remove the oldest sample, or the oldest n samples
+    void popFront();
+    void popFront(size_t n);
+    
+    // Change capacity, keeping the newest samples that still fit
+    void setCapacity(size_t capacity);
+    
+    void clear();
+    
+    size_t size() const { return cursor->count; }
+    size_t capacity() const { return ring_capacity; }
+    bool empty() const { return cursor->count == 0; }
+    bool full() const { return cursor->count == ring_capacity; }
+    
+    // Access by logical index, 0 = oldest
+    double value(size_t index) const { return values[slot(index)]; }
+    long long timestamp(size_t index) const { return timestamps[slot(index)]; }
+    
+    // Physical storage slot of a logical index, for structures that shadow
+    // the ring's storage layout
+    size_t physicalIndex(size_t index) const { return slot(index); }
+    
+    // First logical index whose timestamp is >= timestamp (timestamps must
+    // be non-decreasing); size() if there is none. O(log n).
+    size_t lowerBound(long long timestamp) const;
+    
+    double backValue() const { return value(cursor->count - 1); }
+    long long frontTimestamp() const { return timestamps[cursor->head]; }
+    long long backTimestamp() const { return timestamp(cursor->count - 1); }
+};
+
+#endif // SAMPLE_RING_H
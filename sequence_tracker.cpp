@@ -0,0 +1,106 @@
+#include "sequence_tracker.h"
+#include <arpa/inet.h>
+
+const uint64_t SequenceTracker::WINDOW;
+const uint64_t SequenceTracker::RESTART_DISTANCE;
+const size_t SequenceTracker::MAX_SENDERS;
+
+void LossCounts::add(const LossCounts& other) {
+    kernel_drops += other.kernel_drops;
+    truncated += other.truncated;
+    sequenced += other.sequenced;
+    lost += other.lost;
+    reordered += other.reordered;
+    duplicates += other.duplicates;
+}
+
+LossCounts LossCounts::since(const LossCounts& previous) const {
+    // lost can shrink when late datagrams arrive
+    LossCounts delta;
+    delta.kernel_drops = kernel_drops - previous.kernel_drops;
+    delta.truncated = truncated - previous.truncated;
+    delta.sequenced = sequenced - previous.sequenced;
+    delta.lost = lost > previous.lost ? lost - previous.lost : 0;
+    delta.reordered = reordered - previous.reordered;
+    delta.duplicates = duplicates - previous.duplicates;
+    return delta;
+}
+
+bool LossCounts::operator==(const LossCounts& other) const {
+    return kernel_drops == other.kernel_drops && truncated == other.truncated && sequenced == other.sequenced && lost == other.lost &&
+           reordered == other.reordered && duplicates == other.duplicates;
+}
+
+double LossCounts::lossPercent() const {
+    unsigned long long delivered = sequenced - duplicates;
+    unsigned long long sent = delivered + lost;
+    return sent > 0 ? 100.0 * lost / sent : 0;
+}
+
+uint64_t SequenceTracker::senderKey(const struct sockaddr_in& address) {
+    return (uint64_t)ntohl(address.sin_addr.s_addr) << 16 | ntohs(address.sin_port);
+}
+
+void SequenceTracker::record(uint64_t sender, uint64_t sequence) {
+    std::unordered_map<uint64_t, Stream>::iterator it = streams.find(sender);
+    if (it == streams.end()) {
+        if (streams.size() >= MAX_SENDERS) {
+            return;
+        }
+        ++counts.sequenced;
+        Stream stream = { sequence, 1, false, 0 };
+        streams.insert(std::make_pair(sender, stream));
+        return;
+    }
+    ++counts.sequenced;
+    Stream& stream = it->second;
+    
+    // A datagram below the window is only known to be late, rather than a
+    // restart, once the next one does not continue from it
+    bool continues_below = stream.below && sequence == stream.next_below;
+    if (stream.below && !continues_below && counts.lost > 0) {
+        --counts.lost;
+    }
+    stream.below = false;
+    
+    if (sequence > stream.highest) {
+        uint64_t ahead = sequence - stream.highest;
+        if (ahead > RESTART_DISTANCE) {
+            stream.highest = sequence;
+            stream.seen = 1;
+            return;
+        }
+        
+        // Everything in between is missing until it turns up
+        counts.lost += ahead - 1;
+        stream.seen = ahead >= WINDOW ? 1 : (stream.seen << ahead) | 1;
+        stream.highest = sequence;
+        return;
+    }
+    
+    uint64_t behind = stream.highest - sequence;
+    if (behind > RESTART_DISTANCE) {
+        stream.highest = sequence;
+        stream.seen = 1;
+    } else if (behind >= WINDOW && continues_below) {
+        // A run below the window: the sender started over one datagram ago
+        --counts.reordered;
+        stream.highest = sequence;
+        stream.seen = 3;
+    } else if (behind < WINDOW && (stream.seen & (1ULL << behind))) {
+        ++counts.duplicates;
+    } else if (behind < WINDOW) {
+        // Late rather than lost
+        stream.seen |= 1ULL << behind;
+        ++counts.reordered;
+        if (counts.lost > 0) {
+            --counts.lost;
+        }
+    } else {
+        // Late or a restart, settled by the next datagram. Beyond the window
+        // a repeat cannot be told apart, so it is counted as late too.
+        ++counts.reordered;
+        stream.below = true;
+        stream.next_below = sequence + 1;
+    }
+}
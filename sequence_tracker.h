@@ -0,0 +1,66 @@
+#ifndef SEQUENCE_TRACKER_H
+#define SEQUENCE_TRACKER_H
+
+#include <unordered_map>
+#include <cstddef>
+#include <stdint.h>
+#include <netinet/in.h>
+
+// Loss counters for one receive path. kernel_drops and truncated come from
+// the socket; the rest from senders that number their datagrams.
+struct LossCounts {
+    unsigned long long kernel_drops; // Datagrams the socket buffer had no room for
+    unsigned long long truncated;    // Datagrams larger than the receive buffer, discarded
+    unsigned long long sequenced;    // Datagrams received with a sequence number
+    unsigned long long lost;         // Skipped numbers that have not turned up
+    unsigned long long reordered;    // Arrived after a higher number
+    unsigned long long duplicates;
+    
+    LossCounts() : kernel_drops(0), truncated(0), sequenced(0), lost(0), reordered(0), duplicates(0) {}
+    
+    void add(const LossCounts& other);
+    LossCounts since(const LossCounts& previous) const;
+    bool operator==(const LossCounts& other) const;
+    bool operator!=(const LossCounts& other) const { return !(*this == other); }
+    
+    // Lost as a share of the numbered datagrams that were sent, 0-100
+    double lossPercent() const;
+};
+
+// Detects gaps, reordering and duplicates per sender from the sequence
+// numbers the senders put in their datagrams (@seq=N, or the wire format's
+// sequence field). Each sender keeps the highest number seen and a bitmap of
+// the WINDOW numbers below it, so a late datagram can be told from a repeat.
+//
+// A number more than RESTART_DISTANCE away from the highest, either way, is
+// taken as the sender starting over rather than as loss or lateness. A
+// number below the window but closer is counted late, unless the next
+// datagram continues from it: a run down there is a sender that started
+// over. Used by one receive thread; read the counts from it.
+class SequenceTracker {
+private:
+    struct Stream {
+        uint64_t highest;
+        uint64_t seen; // Bit i: highest - i has arrived
+        bool below;          // The last datagram was below the window,
+        uint64_t next_below; // and this number would continue it
+    };
+    
+    std::unordered_map<uint64_t, Stream> streams; // Keyed by sender address and port
+    LossCounts counts;
+
+public:
+    static const uint64_t WINDOW = 64;
+    static const uint64_t RESTART_DISTANCE = 1024;
+    static const size_t MAX_SENDERS = 4096; // Further senders are not tracked
+    
+    // Key for record() identifying a sender by address and port
+    static uint64_t senderKey(const struct sockaddr_in& address);
+    
+    void record(uint64_t sender, uint64_t sequence);
+    
+    // kernel_drops and truncated are left at 0
+    const LossCounts& getCounts() const { return counts; }
+};
+
+#endif // SEQUENCE_TRACKER_H
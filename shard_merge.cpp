@@ -0,0 +1,101 @@
+#include "shard_merge.h"
+#include <algorithm>
+#include <climits>
+
+const long long ShardMerge::IDLE_DELAY_NS;
+const long long ShardMerge::MAX_HOLD_NS;
+
+ShardMerge::ShardMerge(size_t shard_count, size_t capacity)
+    : staging(shard_count, std::vector<Sample>(capacity)), begins(shard_count, 0), ends(shard_count, 0),
+      held_since(shard_count, 0) {
+}
+
+Sample* ShardMerge::reserve(size_t shard, size_t& room) {
+    std::vector<Sample>& buffer = staging[shard];
+    if (begins[shard] > 0) {
+        std::copy(buffer.begin() + begins[shard], buffer.begin() + ends[shard], buffer.begin());
+        ends[shard] -= begins[shard];
+        begins[shard] = 0;
+    }
+    room = buffer.size() - ends[shard];
+    return &buffer[0] + ends[shard];
+}
+
+size_t ShardMerge::merge(std::vector<Sample>& out, long long now_ns) {
+    size_t shard_count = staging.size();
+    
+    // A shard's later samples are no older than its newest staged one, so
+    // nothing at or below every shard's newest can still be overtaken. The
+    // head counts too, in case a sender's own timestamps went backwards;
+    // that keeps the oldest head at or below the watermark, so every call
+    // makes progress.
+    long long floor = now_ns - IDLE_DELAY_NS;
+    long long watermark = LLONG_MAX;
+    for (size_t i = 0; i < shard_count; ++i) {
+        if (begins[i] < ends[i]) {
+            long long newest = std::max(staging[i][begins[i]].timestamp_ns, staging[i][ends[i] - 1].timestamp_ns);
+            watermark = std::min(watermark, newest);
+        } else {
+            watermark = std::min(watermark, floor);
+        }
+    }
+    watermark = std::max(watermark, floor);
+    
+    // k-way merge on the head timestamps; shard counts are small, so scan.
+    // A head held too long goes first, whatever its timestamp.
+    size_t appended = 0;
+    for (;;) {
+        size_t best = shard_count;
+        bool overdue = false;
+        for (size_t i = 0; i < shard_count && !overdue; ++i) {
+            if (begins[i] == ends[i]) {
+                continue;
+            }
+            long long head = staging[i][begins[i]].timestamp_ns;
+            overdue = held_since[i] != 0 && now_ns - held_since[i] >= MAX_HOLD_NS;
+            if (overdue || (head <= watermark &&
+                            (best == shard_count || head < staging[best][begins[best]].timestamp_ns))) {
+                best = i;
+            }
+        }
+        if (best == shard_count) {
+            break;
+        }
+        out.push_back(staging[best][begins[best]++]);
+        held_since[best] = 0;
+        ++appended;
+    }
+    
+    for (size_t i = 0; i < shard_count; ++i) {
+        if (begins[i] < ends[i] && held_since[i] == 0) {
+            held_since[i] = now_ns;
+        }
+    }
+    return appended;
+}
+
+long long ShardMerge::nanosUntilDue(long long now_ns) const {
+    // The watermark floor passes a held sample IDLE_DELAY_NS after its
+    // timestamp, and a head is forced out MAX_HOLD_NS after it was held
+    long long due = LLONG_MAX;
+    for (size_t i = 0; i < staging.size(); ++i) {
+        if (begins[i] < ends[i]) {
+            due = std::min(due, staging[i][begins[i]].timestamp_ns + IDLE_DELAY_NS);
+            if (held_since[i] != 0) {
+                due = std::min(due, held_since[i] + MAX_HOLD_NS);
+            }
+        }
+    }
+    if (due == LLONG_MAX) {
+        return -1;
+    }
+    return std::max(0LL, due - now_ns);
+}
+
+size_t ShardMerge::getHeldCount() const {
+    size_t held = 0;
+    for (size_t i = 0; i < staging.size(); ++i) {
+        held += ends[i] - begins[i];
+    }
+    return held;
+}
@@ -0,0 +1,50 @@
+#ifndef SHARD_MERGE_H
+#define SHARD_MERGE_H
+
+#include <vector>
+#include <cstddef>
+#include "sample.h"
+
+// Merges the receive shards' sample streams, each in timestamp order, into
+// one ordered stream across drain calls. What a shard hands over waits in
+// its staging buffer until no shard can still deliver anything older: the
+// watermark is the oldest of the non-empty shards' newest staged samples,
+// and an idle shard holds it at now - IDLE_DELAY_NS, the time a datagram it
+// already received may still take to come out of its queue.
+//
+// Sender timestamps can sit far from the receive time, so neither bound
+// is allowed to stall the others: the watermark never falls below
+// now - IDLE_DELAY_NS, so a shard carrying a lagging sender cannot hold
+// back live samples, and a head held for MAX_HOLD_NS (one stamped in the
+// future) is released anyway so the samples queued behind it can follow.
+class ShardMerge {
+private:
+    std::vector<std::vector<Sample> > staging;
+    std::vector<size_t> begins; // First unmerged sample in each buffer
+    std::vector<size_t> ends;   // One past the last staged sample
+    std::vector<long long> held_since; // When each shard's head was first held back, 0 if not
+
+public:
+    static const long long IDLE_DELAY_NS = 10000000; // 10 ms
+    static const long long MAX_HOLD_NS = 100000000;  // 100 ms
+    
+    // shard_count buffers of capacity samples each
+    ShardMerge(size_t shard_count, size_t capacity);
+    
+    // Space at the end of shard's buffer, after moving its unmerged samples
+    // to the front. Fill up to room samples there, then commit() them.
+    Sample* reserve(size_t shard, size_t& room);
+    void commit(size_t shard, size_t count) { ends[shard] += count; }
+    
+    // Append the staged samples up to the watermark to out in timestamp
+    // order. Returns the number appended.
+    size_t merge(std::vector<Sample>& out, long long now_ns);
+    
+    // Time until merge() can release the oldest held sample without more
+    // input, -1 if none is held
+    long long nanosUntilDue(long long now_ns) const;
+    
+    size_t getHeldCount() const;
+};
+
+#endif // SHARD_MERGE_H
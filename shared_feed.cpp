@@ -0,0 +1,236 @@
+#include "shared_feed.h"
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+
+namespace {
+    const size_t SLOT_ALIGN = 64;
+    const size_t SLOTS_OFFSET = (sizeof(FeedHeader) + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+    const size_t FEED_LENGTH = SLOTS_OFFSET + FEED_SLOTS * sizeof(FeedSlot);
+    
+    // shm_open wants a single leading slash
+    std::string objectName(const std::string& name) {
+        if (name.empty() || name.find('/', 1) != std::string::npos) {
+            throw std::runtime_error("Invalid feed name '" + name + "'");
+        }
+        return name[0] == '/' ? name : "/" + name;
+    }
+    
+    bool sharedAtomics() {
+        // The mapping is only coherent if the atomics are plain memory
+        std::atomic<uint64_t> wide(0);
+        std::atomic<uint32_t> narrow(0);
+        return wide.is_lock_free() && narrow.is_lock_free();
+    }
+}
+
+FeedPublisher::FeedPublisher(const std::string& name, const ChannelRegistry* channel_names)
+    : fd(-1), header(nullptr), slots(nullptr), length(FEED_LENGTH), head(0), channels(channel_names),
+      names_published(0) {
+    if (!sharedAtomics()) {
+        throw std::runtime_error("Shared memory feeds need lock-free 64-bit atomics");
+    }
+    std::string object = objectName(name);
+    fd = shm_open(object.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open feed " + name + ": " + strerror(errno));
+    }
+    
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        std::string error = errno == EWOULDBLOCK ? "in use by another publisher" : strerror(errno);
+        close(fd);
+        throw std::runtime_error("Cannot publish to " + name + ": " + error);
+    }
+    if (ftruncate(fd, length) < 0) {
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("Failed to size feed " + name + ": " + error);
+    }
+    
+    void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("Failed to map feed " + name + ": " + error);
+    }
+    header = (FeedHeader*)mapping;
+    slots = (FeedSlot*)((char*)mapping + SLOTS_OFFSET);
+    
+    // Carry on from a previous publisher's position so no sequence number
+    // is reused while its viewers are still attached
+    bool valid = std::memcmp(header->magic, FEED_MAGIC, sizeof(FEED_MAGIC)) == 0 &&
+                 header->version == FEED_VERSION && header->slot_count == FEED_SLOTS;
+    if (valid) {
+        head = header->head.load(std::memory_order_relaxed);
+    } else {
+        std::memset(mapping, 0, length);
+        header->version = FEED_VERSION;
+        header->slot_count = FEED_SLOTS;
+        std::memcpy(header->magic, FEED_MAGIC, sizeof(FEED_MAGIC));
+    }
+    for (FeedName& entry : header->names) {
+        entry.length.store(0, std::memory_order_relaxed);
+    }
+    header->epoch.store(currentTimeNs(), std::memory_order_release);
+}
+
+FeedPublisher::~FeedPublisher() {
+    munmap(header, length);
+    close(fd);
+}
+
+void FeedPublisher::publishNames() {
+    size_t count = channels->size();
+    for (; names_published < count; ++names_published) {
+        FeedName& entry = header->names[names_published];
+        const std::string& name = channels->getName((uint16_t)names_published);
+        std::memcpy(entry.name, name.data(), name.size());
+        entry.name[name.size()] = '\0';
+        entry.length.store((uint32_t)name.size() + 1, std::memory_order_release); // +1: the default channel is ""
+    }
+}
+
+void FeedPublisher::publish(const std::vector<Sample>& samples) {
+    if (samples.empty()) {
+        return;
+    }
+    
+    // Names first, so a viewer that finds a sample can also find its name
+    if (channels && channels->size() > names_published) {
+        publishNames();
+    }
+    
+    for (const Sample& sample : samples) {
+        FeedSlot& slot = slots[head & (FEED_SLOTS - 1)];
+        uint64_t value_bits;
+        std::memcpy(&value_bits, &sample.value, sizeof(value_bits));
+        
+        slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.timestamp_ns.store((uint64_t)sample.timestamp_ns, std::memory_order_relaxed);
+        slot.value_bits.store(value_bits, std::memory_order_relaxed);
+        slot.channel.store(sample.channel, std::memory_order_relaxed);
+        slot.sequence.store(2 * head + 2, std::memory_order_release);
+        ++head;
+    }
+    header->head.store(head, std::memory_order_release);
+}
+
+FeedViewer::FeedViewer(const std::string& name)
+    : fd(-1), header(nullptr), slots(nullptr), length(FEED_LENGTH), next(0), epoch(0),
+      sample_count(0), missed_count(0) {
+    if (!sharedAtomics()) {
+        throw std::runtime_error("Shared memory feeds need lock-free 64-bit atomics");
+    }
+    std::string object = objectName(name);
+    fd = shm_open(object.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        std::string error = errno == ENOENT ? "no publisher has created it" : strerror(errno);
+        throw std::runtime_error("Cannot view feed " + name + ": " + error);
+    }
+    
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("Failed to map feed " + name + ": " + error);
+    }
+    header = (const FeedHeader*)mapping;
+    slots = (const FeedSlot*)((const char*)mapping + SLOTS_OFFSET);
+    
+    if (std::memcmp(header->magic, FEED_MAGIC, sizeof(FEED_MAGIC)) != 0 || header->version != FEED_VERSION ||
+        header->slot_count != FEED_SLOTS) {
+        munmap(mapping, length);
+        close(fd);
+        throw std::runtime_error("Feed " + name + " has an unknown format");
+    }
+    
+    // Start with whatever the ring still holds, so the graph is not empty
+    uint64_t published = header->head.load(std::memory_order_acquire);
+    next = published > FEED_SLOTS ? published - FEED_SLOTS : 0;
+    for (uint16_t& id : local_ids) {
+        id = ChannelRegistry::INVALID_CHANNEL;
+    }
+}
+
+FeedViewer::~FeedViewer() {
+    munmap((void*)header, length);
+    close(fd);
+}
+
+uint16_t FeedViewer::localChannel(uint64_t channel) {
+    if (channel >= ChannelRegistry::MAX_CHANNELS) {
+        return ChannelRegistry::INVALID_CHANNEL;
+    }
+    if (local_ids[channel] == ChannelRegistry::INVALID_CHANNEL) {
+        const FeedName& entry = header->names[channel];
+        uint32_t stored = entry.length.load(std::memory_order_acquire);
+        if (stored == 0) {
+            return ChannelRegistry::INVALID_CHANNEL; // Name not out yet; the publisher sends it first
+        }
+        if (stored == 1) {
+            local_ids[channel] = ChannelRegistry::DEFAULT_CHANNEL;
+        } else {
+            char name[sizeof(entry.name)];
+            size_t name_length = std::min<size_t>(stored - 1, sizeof(name) - 1);
+            std::memcpy(name, entry.name, name_length);
+            local_ids[channel] = channels.intern(name, name_length);
+        }
+    }
+    return local_ids[channel];
+}
+
+size_t FeedViewer::drain(std::vector<Sample>& out, size_t max_samples) {
+    // A new publisher may hand out channel ids differently
+    uint64_t current_epoch = header->epoch.load(std::memory_order_acquire);
+    if (current_epoch != epoch) {
+        epoch = current_epoch;
+        for (uint16_t& id : local_ids) {
+            id = ChannelRegistry::INVALID_CHANNEL;
+        }
+    }
+    
+    uint64_t published = header->head.load(std::memory_order_acquire);
+    size_t appended = 0;
+    while (next < published && appended < max_samples) {
+        if (published - next > FEED_SLOTS) {
+            // Lapped while away: skip to the oldest slot still intact
+            missed_count += published - next - FEED_SLOTS;
+            next = published - FEED_SLOTS;
+        }
+        
+        const FeedSlot& slot = slots[next & (FEED_SLOTS - 1)];
+        uint64_t expected = 2 * next + 2;
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        uint64_t timestamp_ns = slot.timestamp_ns.load(std::memory_order_relaxed);
+        uint64_t value_bits = slot.value_bits.load(std::memory_order_relaxed);
+        uint64_t channel = slot.channel.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+        if (before != expected || after != expected) {
+            // Overwritten under us; the writer is a whole ring ahead
+            ++missed_count;
+            ++next;
+            published = header->head.load(std::memory_order_acquire);
+            continue;
+        }
+        ++next;
+        
+        Sample sample;
+        sample.timestamp_ns = (long long)timestamp_ns;
+        std::memcpy(&sample.value, &value_bits, sizeof(sample.value));
+        sample.channel = localChannel(channel);
+        if (sample.channel == ChannelRegistry::INVALID_CHANNEL) {
+            continue;
+        }
+        out.push_back(sample);
+        ++appended;
+    }
+    sample_count += appended;
+    return appended;
+}
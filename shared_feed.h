@@ -0,0 +1,117 @@
+#ifndef SHARED_FEED_H
+#define SHARED_FEED_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+#include "sample.h"
+#include "channel_registry.h"
+
+// Parsed samples shared through POSIX shared memory (--publish/--view), so
+// one process owns the socket and parses while any number of viewers draw.
+//
+// Layout of the shared object (host byte order, one writer):
+//   header    magic "UDPGFEED", version, slot count, the publisher's epoch
+//             and head, the number of samples ever published
+//   names     one entry per channel id: length (published last) and name
+//   slots     ring of FEED_SLOTS samples; position n lives in slot n % FEED_SLOTS
+//
+// Each slot is a seqlock: the writer stores 2n+1 in its sequence, the
+// sample, then 2n+2. A reader that sees 2n+2 both before and after copying
+// the sample has position n intact; anything else means the writer lapped
+// it. The writer never waits for readers, and a slow viewer only loses the
+// samples that were overwritten before it got to them.
+//
+// Positions keep counting across publisher restarts, so a sequence number
+// is never reused; the epoch changes instead and viewers look the channel
+// names up again.
+
+const char FEED_MAGIC[8] = { 'U', 'D', 'P', 'G', 'F', 'E', 'E', 'D' };
+const uint32_t FEED_VERSION = 1;
+const size_t FEED_SLOTS = 1 << 20; // Power of two, 32 MiB of samples
+
+struct FeedSlot {
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> timestamp_ns;
+    std::atomic<uint64_t> value_bits;
+    std::atomic<uint64_t> channel;
+};
+
+struct FeedName {
+    std::atomic<uint32_t> length; // 0 until the name is stored
+    char name[ChannelRegistry::MAX_NAME_LENGTH + 1];
+};
+
+struct FeedHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    std::atomic<uint64_t> epoch; // Start time of the current publisher
+    char padding[40];            // head gets a cache line of its own
+    std::atomic<uint64_t> head;  // Next position to be written
+    FeedName names[ChannelRegistry::MAX_CHANNELS];
+};
+
+// Writer side, run by the ingesting process. Only one publisher can hold a
+// feed; the shared object stays in /dev/shm after exit so running viewers
+// pick up a restarted publisher.
+class FeedPublisher {
+private:
+    int fd;
+    FeedHeader* header;
+    FeedSlot* slots;
+    size_t length;
+    uint64_t head;
+    const ChannelRegistry* channels;
+    size_t names_published;
+    
+    void publishNames();
+
+public:
+    // Create or take over the feed called name; throws std::runtime_error
+    // if it cannot be mapped or another publisher holds it
+    FeedPublisher(const std::string& name, const ChannelRegistry* channel_names);
+    ~FeedPublisher();
+    
+    // Append samples to the ring and make them visible to viewers
+    void publish(const std::vector<Sample>& samples);
+};
+
+// Read-only side: maps a feed and copies new samples out of it. Channel ids
+// are translated to a registry of its own, so the ids stay valid when the
+// publisher restarts with other names.
+class FeedViewer {
+private:
+    int fd;
+    const FeedHeader* header;
+    const FeedSlot* slots;
+    size_t length;
+    uint64_t next; // Next position to read
+    uint64_t epoch;
+    ChannelRegistry channels;
+    uint16_t local_ids[ChannelRegistry::MAX_CHANNELS]; // Publisher id to ours, INVALID if not looked up
+    unsigned long long sample_count;
+    unsigned long long missed_count;
+    
+    uint16_t localChannel(uint64_t channel);
+
+public:
+    // Map the feed called name; throws std::runtime_error if there is none
+    explicit FeedViewer(const std::string& name);
+    ~FeedViewer();
+    
+    // Copy published samples into out, at most max_samples. Returns the
+    // number appended.
+    size_t drain(std::vector<Sample>& out, size_t max_samples);
+    
+    const ChannelRegistry& getChannels() const { return channels; }
+    ChannelRegistry& getChannels() { return channels; }
+    unsigned long long getSampleCount() const { return sample_count; }
+    
+    // Samples overwritten before this viewer read them
+    unsigned long long getMissedCount() const { return missed_count; }
+};
+
+#endif // SHARED_FEED_H
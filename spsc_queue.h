@@ -0,0 +1,112 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+#include <type_traits>
+
+// What a full queue does with a new item
+enum class OverflowPolicy {
+    DROP_OLDEST, // Discard the oldest queued item to make room
+    BLOCK        // Wait until the consumer makes room
+};
+
+// Bounded lock-free single-producer/single-consumer ring.
+//
+// The producer owns head and the consumer owns tail, except that with
+// DROP_OLDEST a producer facing a full ring advances tail itself. To stay
+// correct under that race the consumer copies items out first and only
+// then claims them with a CAS on tail; if the producer dropped them in the
+// meantime the copies are discarded. That is why T must be trivially
+// copyable.
+template <typename T>
+class SpscQueue {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscQueue items must be trivially copyable");
+    
+private:
+    std::vector<T> slots;
+    size_t mask;
+    OverflowPolicy policy;
+    
+    // Keep producer and consumer indices on separate cache lines
+    char pad0[64];
+    std::atomic<size_t> head; // Next slot to write, producer side
+    char pad1[64];
+    std::atomic<size_t> tail; // Next slot to read, consumer side
+    char pad2[64];
+    std::atomic<unsigned long long> dropped;
+    std::atomic<bool> closed;
+    
+public:
+    // Capacity is rounded up to a power of two
+    SpscQueue(size_t capacity, OverflowPolicy overflow = OverflowPolicy::DROP_OLDEST)
+        : policy(overflow), head(0), tail(0), dropped(0), closed(false) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+    
+    // Producer: enqueue an item. Returns false only if a BLOCK queue was
+    // closed while waiting for room.
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t t = tail.load(std::memory_order_acquire);
+            if (h - t < slots.size()) {
+                break;
+            }
+            
+            if (policy == OverflowPolicy::DROP_OLDEST) {
+                if (tail.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel)) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+            } else {
+                if (closed.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        
+        slots[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer: dequeue up to max_items into out. Returns the number dequeued.
+    size_t popBatch(T* out, size_t max_items) {
+        size_t t = tail.load(std::memory_order_acquire);
+        for (;;) {
+            size_t h = head.load(std::memory_order_acquire);
+            size_t available = h - t;
+            if (available == 0) {
+                return 0;
+            }
+            size_t n = available < max_items ? available : max_items;
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = slots[(t + i) & mask];
+            }
+            
+            // Claim the copied items; fails if the producer dropped some of
+            // them meanwhile, in which case t is reloaded and we retry
+            if (tail.compare_exchange_strong(t, t + n, std::memory_order_acq_rel)) {
+                return n;
+            }
+        }
+    }
+    
+    // Wake a producer blocked on a full queue so it can give up
+    void close() { closed.store(true, std::memory_order_relaxed); }
+    
+    size_t capacity() const { return slots.size(); }
+    unsigned long long getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+#endif // SPSC_QUEUE_H
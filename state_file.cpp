@@ -0,0 +1,124 @@
+#include "state_file.h"
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const uint32_t StateFile::VERSION;
+const size_t StateFile::DEFAULT_CAPACITY;
+
+namespace {
+    const char STATE_MAGIC[8] = { 'U', 'D', 'P', 'G', 'S', 'T', 'A', 'T' };
+    const size_t PAGE_ALIGN = 4096;
+    
+    size_t alignUp(size_t bytes) {
+        return (bytes + PAGE_ALIGN - 1) / PAGE_ALIGN * PAGE_ALIGN;
+    }
+}
+
+StateFile::StateFile(const std::string& path, size_t points)
+    : fd(-1), base(nullptr), length(0), capacity(points), restored(false) {
+    channel_bytes = alignUp(capacity * (sizeof(double) + sizeof(long long)));
+    data_offset = alignUp(sizeof(Header) + ChannelRegistry::MAX_CHANNELS * sizeof(ChannelRecord));
+    length = data_offset + ChannelRegistry::MAX_CHANNELS * channel_bytes;
+    
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path + ": " + strerror(errno));
+    }
+    
+    // Two monitors writing the same rings would corrupt each other
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        std::string error = errno == EWOULDBLOCK ? "in use by another monitor" : strerror(errno);
+        close(fd);
+        throw std::runtime_error("Cannot lock " + path + ": " + error);
+    }
+    
+    struct stat info;
+    bool sized = fstat(fd, &info) == 0 && (size_t)info.st_size == length;
+    if (!sized && (ftruncate(fd, 0) < 0 || ftruncate(fd, length) < 0)) {
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("Failed to size " + path + ": " + error);
+    }
+    
+    void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("Failed to map " + path + ": " + error);
+    }
+    base = (char*)mapping;
+    
+    restored = sized && headerMatches();
+    if (!restored) {
+        // Start afresh: a cleared header region means no channels
+        std::memset(base, 0, data_offset);
+        Header* h = header();
+        std::memcpy(h->magic, STATE_MAGIC, sizeof(STATE_MAGIC));
+        h->version = VERSION;
+        h->channel_count = ChannelRegistry::MAX_CHANNELS;
+        h->capacity = capacity;
+        h->channel_bytes = channel_bytes;
+        h->data_offset = data_offset;
+    }
+}
+
+StateFile::~StateFile() {
+    // Dirty pages are written back by the kernel after unmapping as well
+    munmap(base, length);
+    close(fd);
+}
+
+bool StateFile::headerMatches() const {
+    const Header* h = header();
+    return std::memcmp(h->magic, STATE_MAGIC, sizeof(STATE_MAGIC)) == 0 && h->version == VERSION &&
+           h->channel_count == ChannelRegistry::MAX_CHANNELS && h->capacity == capacity &&
+           h->channel_bytes == channel_bytes && h->data_offset == data_offset;
+}
+
+StateFile::ChannelRecord& StateFile::getChannel(uint16_t channel) const {
+    ChannelRecord* records = (ChannelRecord*)(base + sizeof(Header));
+    return records[channel];
+}
+
+double* StateFile::getValues(uint16_t channel) const {
+    return (double*)(base + data_offset + channel * channel_bytes);
+}
+
+long long* StateFile::getTimestamps(uint16_t channel) const {
+    return (long long*)(base + data_offset + channel * channel_bytes + capacity * sizeof(double));
+}
+
+void StateFile::restoreChannels(ChannelRegistry& registry) {
+    for (uint16_t slot = 1; slot < ChannelRegistry::MAX_CHANNELS; ++slot) {
+        ChannelRecord& record = getChannel(slot);
+        if (!record.active) {
+            continue;
+        }
+        
+        size_t name_length = strnlen(record.name, sizeof(record.name));
+        uint16_t channel = registry.intern(record.name, name_length);
+        if (channel == slot) {
+            continue;
+        }
+        // Ids are handed out in order, so channel < slot and is free unless
+        // the name was saved twice
+        if (channel == ChannelRegistry::INVALID_CHANNEL || getChannel(channel).active) {
+            record.active = 0;
+        } else {
+            moveChannel(slot, channel);
+        }
+    }
+}
+
+void StateFile::moveChannel(uint16_t from, uint16_t to) {
+    std::memcpy(getValues(to), getValues(from), capacity * sizeof(double));
+    std::memcpy(getTimestamps(to), getTimestamps(from), capacity * sizeof(long long));
+    getChannel(to) = getChannel(from);
+    std::memset(&getChannel(from), 0, sizeof(ChannelRecord));
+}
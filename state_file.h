@@ -0,0 +1,76 @@
+#ifndef STATE_FILE_H
+#define STATE_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+#include "sample_ring.h"
+#include "channel_registry.h"
+
+// Memory-mapped backing for the graph's sample rings (--state). The file
+// holds a versioned header, one record per channel (ring cursor and name)
+// and every channel's value and timestamp arrays. Rings attached to it
+// store samples straight into the shared mapping, so keeping the file
+// current costs no syscalls: the kernel writes dirty pages back on its own,
+// and a restarted monitor maps the same arrays again instead of replaying.
+//
+// The file is sized for every channel up front but stays sparse; only
+// channels that receive data take up disk space.
+class StateFile {
+public:
+    static const uint32_t VERSION = 1;
+    
+    // Points per channel, the retention of the ring plus compressed history
+    static const size_t DEFAULT_CAPACITY = 100000;
+    
+    struct ChannelRecord {
+        SampleRing::Cursor cursor;
+        uint32_t active; // Holds a series
+        uint32_t reserved;
+        char name[ChannelRegistry::MAX_NAME_LENGTH + 1];
+    };
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t channel_count;
+        uint64_t capacity;
+        uint64_t channel_bytes; // Size of one channel's arrays, page aligned
+        uint64_t data_offset;   // Start of channel 0's arrays, page aligned
+    };
+    
+    int fd;
+    char* base;
+    size_t length;
+    size_t capacity;
+    size_t channel_bytes;
+    size_t data_offset;
+    bool restored;
+    
+    Header* header() const { return (Header*)base; }
+    bool headerMatches() const;
+    void moveChannel(uint16_t from, uint16_t to);
+
+public:
+    // Open or create path for rings of points samples. A file with another
+    // version or layout is started afresh. Throws std::runtime_error if the
+    // file cannot be mapped or another monitor holds it.
+    explicit StateFile(const std::string& path, size_t points = DEFAULT_CAPACITY);
+    ~StateFile();
+    
+    // Register the saved channel names in registry in id order, which gives
+    // them back their ids in a fresh registry; a saved channel is moved down
+    // if an unsaved one left a gap. Call before anything else interns names.
+    void restoreChannels(ChannelRegistry& registry);
+    
+    ChannelRecord& getChannel(uint16_t channel) const;
+    double* getValues(uint16_t channel) const;
+    long long* getTimestamps(uint16_t channel) const;
+    
+    // The file held a valid state when it was opened
+    bool wasRestored() const { return restored; }
+    size_t getCapacity() const { return capacity; }
+};
+
+#endif // STATE_FILE_H
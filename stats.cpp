@@ -0,0 +1,174 @@
+#include "stats.h"
+#include "sample.h"
+#include <sstream>
+#include <iomanip>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+const int HistogramSnapshot::BUCKETS;
+const int PipelineStats::DEFAULT_INTERVAL_MS;
+
+void HistogramSnapshot::reset() {
+    for (int i = 0; i < BUCKETS; ++i) {
+        counts[i] = 0;
+    }
+    total = 0;
+    sum = 0;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    for (int i = 0; i < BUCKETS; ++i) {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    sum += other.sum;
+}
+
+HistogramSnapshot HistogramSnapshot::since(const HistogramSnapshot& previous) const {
+    HistogramSnapshot delta;
+    for (int i = 0; i < BUCKETS; ++i) {
+        delta.counts[i] = counts[i] - previous.counts[i];
+    }
+    delta.total = total - previous.total;
+    delta.sum = sum - previous.sum;
+    return delta;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p / 100.0 * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // Middle of the bucket
+            uint64_t low = LatencyHistogram::bucketLow(i);
+            uint64_t high = i + 1 < BUCKETS ? LatencyHistogram::bucketLow(i + 1) : low;
+            return low + (high - low) / 2;
+        }
+    }
+    return LatencyHistogram::bucketLow(BUCKETS - 1);
+}
+
+LatencyHistogram::LatencyHistogram() : total(0), sum(0) {
+    for (int i = 0; i < HistogramSnapshot::BUCKETS; ++i) {
+        counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < 4) {
+        return (int)value;
+    }
+    // Power of two, then the next two bits below the leading one
+    int exponent = 63 - __builtin_clzll(value);
+    int sub_bucket = (int)(value >> (exponent - 2)) & 3;
+    return ((exponent - 1) << 2) | sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucketLow(int bucket) {
+    if (bucket < 4) {
+        return (uint64_t)bucket;
+    }
+    int exponent = (bucket >> 2) + 1;
+    return (uint64_t)(4 | (bucket & 3)) << (exponent - 2);
+}
+
+void LatencyHistogram::addTo(HistogramSnapshot& out) const {
+    for (int i = 0; i < HistogramSnapshot::BUCKETS; ++i) {
+        out.counts[i] += counts[i].load(std::memory_order_relaxed);
+    }
+    out.total += total.load(std::memory_order_relaxed);
+    out.sum += sum.load(std::memory_order_relaxed);
+}
+
+PipelineStats::PipelineStats(const std::string& dump_path, int interval)
+    : interval_ms(interval > 0 ? interval : DEFAULT_INTERVAL_MS), interval_start(monotonicNanos()),
+      last_datagrams(0), last_values(0), dump(nullptr) {
+    if (!dump_path.empty()) {
+        dump = std::fopen(dump_path.c_str(), "a");
+        if (!dump) {
+            throw std::runtime_error("Failed to open " + dump_path + ": " + std::strerror(errno));
+        }
+    }
+}
+
+PipelineStats::~PipelineStats() {
+    if (dump) {
+        std::fclose(dump);
+    }
+}
+
+long long PipelineStats::nanosUntilTick() const {
+    long long remaining = (long long)(interval_start + (uint64_t)interval_ms * 1000000ULL - monotonicNanos());
+    return remaining > 0 ? remaining : 0;
+}
+
+bool PipelineStats::tick(unsigned long long datagrams, unsigned long long values, const HistogramSnapshot& parse,
+                         unsigned long long dropped, const LossCounts& loss) {
+    uint64_t now = monotonicNanos();
+    uint64_t elapsed = now - interval_start;
+    if (elapsed < (uint64_t)interval_ms * 1000000ULL) {
+        return false;
+    }
+    double seconds = elapsed / 1e9;
+    interval_start = now;
+    
+    HistogramSnapshot update, render, bytes;
+    update_ns.addTo(update);
+    render_ns.addTo(render);
+    frame_bytes.addTo(bytes);
+    HistogramSnapshot parse_delta = parse.since(last_parse);
+    HistogramSnapshot update_delta = update.since(last_update);
+    HistogramSnapshot render_delta = render.since(last_render);
+    HistogramSnapshot bytes_delta = bytes.since(last_bytes);
+    
+    double datagram_rate = (datagrams - last_datagrams) / seconds;
+    double value_rate = (values - last_values) / seconds;
+    last_datagrams = datagrams;
+    last_values = values;
+    last_parse = parse;
+    last_update = update;
+    last_render = render;
+    last_bytes = bytes;
+    LossCounts loss_delta = loss.since(last_loss);
+    last_loss = loss;
+    
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(0)
+        << "dg/s:" << datagram_rate << " val/s:" << value_rate
+        << " parse:" << parse_delta.percentile(50) << "/" << parse_delta.percentile(99) << "ns"
+        << " upd:" << update_delta.percentile(50) << "/" << update_delta.percentile(99) << "ns"
+        << std::setprecision(2)
+        << " render:" << render_delta.percentile(50) / 1e6 << "/" << render_delta.percentile(99) / 1e6 << "ms"
+        << std::setprecision(0)
+        << " out:" << bytes_delta.mean() << "B/frame"
+        << " fps:" << render_delta.total / seconds
+        << " drop:" << dropped
+        << " kdrop:" << loss.kernel_drops;
+    if (loss.sequenced > 0) {
+        out << std::setprecision(2) << " loss:" << loss_delta.lossPercent() << "%";
+    }
+    line = out.str();
+    
+    if (dump) {
+        std::fprintf(dump,
+                     "time_ms=%lld datagrams_per_s=%.0f values_per_s=%.0f "
+                     "parse_ns_p50=%llu parse_ns_p99=%llu update_ns_p50=%llu update_ns_p99=%llu "
+                     "render_us_p50=%llu render_us_p99=%llu frames=%llu frame_bytes_mean=%.0f dropped=%llu "
+                     "kernel_drops=%llu truncated=%llu sequenced=%llu lost=%llu reordered=%llu duplicates=%llu loss_pct=%.3f\n",
+                     currentTimeMs(), datagram_rate, value_rate,
+                     (unsigned long long)parse_delta.percentile(50), (unsigned long long)parse_delta.percentile(99),
+                     (unsigned long long)update_delta.percentile(50), (unsigned long long)update_delta.percentile(99),
+                     (unsigned long long)render_delta.percentile(50) / 1000,
+                     (unsigned long long)render_delta.percentile(99) / 1000,
+                     (unsigned long long)render_delta.total, bytes_delta.mean(), dropped,
+                     loss.kernel_drops, loss.truncated, loss.sequenced, loss.lost, loss.reordered, loss.duplicates,
+                     loss_delta.lossPercent());
+        std::fflush(dump);
+    }
+    return true;
+}
@@ -0,0 +1,118 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+#include <time.h>
+#include "sequence_tracker.h"
+
+// Monotonic clock in ns for timing pipeline stages (vDSO, no syscall)
+inline uint64_t monotonicNanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Plain copy of a histogram, used for merging shards and interval deltas
+struct HistogramSnapshot {
+    static const int BUCKETS = 256;
+    
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    
+    HistogramSnapshot() { reset(); }
+    void reset();
+    void merge(const HistogramSnapshot& other);
+    
+    // Counts recorded since previous, which must be an earlier copy
+    HistogramSnapshot since(const HistogramSnapshot& previous) const;
+    
+    // Approximate value at percentile p (0-100), within 12.5% of the true value
+    uint64_t percentile(double p) const;
+    double mean() const { return total > 0 ? double(sum) / total : 0; }
+};
+
+// Fixed-bucket log-linear histogram: four buckets per power of two over
+// the full uint64 range, so recording is a few instructions with no
+// allocation. Written by one thread, readable from any thread.
+class LatencyHistogram {
+private:
+    std::atomic<uint64_t> counts[HistogramSnapshot::BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    
+    static void bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+        // Single writer, so a plain load and store is enough
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+    
+public:
+    LatencyHistogram();
+    
+    static int bucketOf(uint64_t value);
+    static uint64_t bucketLow(int bucket);
+    
+    void record(uint64_t value) {
+        bump(counts[bucketOf(value)], 1);
+        bump(total, 1);
+        bump(sum, value);
+    }
+    
+    // Add the current counts to out
+    void addTo(HistogramSnapshot& out) const;
+};
+
+// Per-interval view of the pipeline for the stats line and the stats file.
+// The UI thread records its own stages here; receive-side counters and the
+// parse histogram are passed in on each tick.
+class PipelineStats {
+private:
+    LatencyHistogram update_ns; // addDataPoint() per value, averaged over a drained batch
+    LatencyHistogram render_ns; // render() per frame, including the terminal write
+    LatencyHistogram frame_bytes;
+    
+    int interval_ms;
+    uint64_t interval_start;
+    unsigned long long last_datagrams;
+    unsigned long long last_values;
+    HistogramSnapshot last_parse;
+    HistogramSnapshot last_update;
+    HistogramSnapshot last_render;
+    HistogramSnapshot last_bytes;
+    LossCounts last_loss;
+    
+    std::string line;
+    FILE* dump; // Stats file, null if not dumping
+    
+public:
+    static const int DEFAULT_INTERVAL_MS = 1000;
+    
+    // Append one line per interval to dump_path if it is not empty
+    explicit PipelineStats(const std::string& dump_path = std::string(), int interval = DEFAULT_INTERVAL_MS);
+    ~PipelineStats();
+    
+    void recordUpdate(uint64_t elapsed_ns, size_t values) {
+        if (values > 0) {
+            update_ns.record(elapsed_ns / values);
+        }
+    }
+    void recordRender(uint64_t elapsed_ns, size_t bytes) {
+        render_ns.record(elapsed_ns);
+        frame_bytes.record(bytes);
+    }
+    
+    // Close the interval if it has elapsed, given the running receive-side
+    // totals. Returns true when getLine() changed.
+    bool tick(unsigned long long datagrams, unsigned long long values, const HistogramSnapshot& parse,
+              unsigned long long dropped, const LossCounts& loss = LossCounts());
+    
+    // Nanoseconds until the current interval ends and tick() has work
+    long long nanosUntilTick() const;
+    
+    const std::string& getLine() const { return line; }
+};
+
+#endif // STATS_H
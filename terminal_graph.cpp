@@ -1,90 +1,283 @@
 #include "terminal_graph.h"
-#include <iostream>
+#include "sample.h"
 #include <iomanip>
 #include <algorithm>
 #include <cmath>
 #include <sstream>
-#include <chrono>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
 
-TerminalGraph::TerminalGraph(int w, int h, int minutes) 
-    : width(w), height(h), min_value(0), max_value(100), 
-      time_window_minutes(minutes), avg_interval_seconds(1.0), last_data_time(0) {
+namespace {
+    // High/low value colors for each pane, cycled by pane index
+    const int16_t PANE_COLORS[][2] = {
+        { FrameBuffer::GREEN, FrameBuffer::CYAN },
+        { 3, 1 },   // Yellow / red
+        { 5, 4 },   // Magenta / blue
+        { 10, 14 }, // Bright green / bright cyan
+        { 11, 9 },  // Bright yellow / bright red
+        { 13, 12 }, // Bright magenta / bright blue
+    };
+    const size_t PANE_COLOR_COUNT = sizeof(PANE_COLORS) / sizeof(PANE_COLORS[0]);
+    
+    // Rows a stacked pane needs besides its graph: status line and x-axis
+    const int PANE_CHROME_ROWS = 2;
+    const int MIN_PANE_GRAPH_ROWS = 3;
+    
+    // Raw points per series
+    const size_t MAX_RING_POINTS = 10000;
+    
+    // Compressed history per series, as much memory as a full raw ring.
+    // Noisy doubles pack to about 8 bytes a point (the XOR of their
+    // mantissas is mostly significant bits), integer counters to about 3
+    // and flat runs to under 1, so the budget holds 2x to 20x the ring.
+    const size_t HISTORY_BYTES = MAX_RING_POINTS * (sizeof(double) + sizeof(long long));
+    const size_t HISTORY_BYTES_PER_POINT = 8; // Worst case, before a series shows its own
+    
+    const long long NS_PER_MS = 1000000;
+    const long long NS_PER_SECOND = 1000000000;
+    
+    // Narrowest span the view zooms in to
+    const long long MIN_VIEW_NS = NS_PER_SECOND;
+    
+    // Bar tops by the number of filled eighths of the cell
+    const uint32_t BAR_GLYPHS[9] = {
+        ' ', 0x2581, 0x2582, 0x2583, 0x2584, 0x2585, 0x2586, 0x2587, 0x2588 // ▁▂▃▄▅▆▇█
+    };
+    
+    // Braille cells are a 2x4 dot grid; the glyph is U+2800 plus the dot bits
+    const uint32_t BRAILLE_BASE = 0x2800;
+    const int BRAILLE_DOTS_X = 2;
+    const int BRAILLE_DOTS_Y = 4;
+    
+    // Dot bits for a vertical run from dot row first to last (0 = top),
+    // by dot column: BRAILLE_SPAN[column][first][last]
+    const uint8_t BRAILLE_SPAN[BRAILLE_DOTS_X][BRAILLE_DOTS_Y][BRAILLE_DOTS_Y] = {
+        {
+            { 0x01, 0x03, 0x07, 0x47 },
+            { 0x00, 0x02, 0x06, 0x46 },
+            { 0x00, 0x00, 0x04, 0x44 },
+            { 0x00, 0x00, 0x00, 0x40 },
+        },
+        {
+            { 0x08, 0x18, 0x38, 0xb8 },
+            { 0x00, 0x10, 0x30, 0xb0 },
+            { 0x00, 0x00, 0x20, 0xa0 },
+            { 0x00, 0x00, 0x00, 0x80 },
+        },
+    };
+    
+    // Heatmap colors from sparse to dense, 256-color palette: blue through
+    // cyan and green to yellow and red
+    const int16_t HEAT_RAMP[] = {
+        17, 18, 19, 20, 21, 27, 33, 39, 45, 51, 50, 49, 48, 47, 46, 82, 118, 154, 190, 226, 220, 214, 208, 202, 196
+    };
+    const int HEAT_LEVELS = sizeof(HEAT_RAMP) / sizeof(HEAT_RAMP[0]);
+    
+    // Points a history of bytes holds at the series' own ratio so far
+    size_t historyCapacity(const CompressedHistory& history, size_t bytes) {
+        if (history.empty() || history.getBytes() == 0) {
+            return bytes / HISTORY_BYTES_PER_POINT;
+        }
+        return (size_t)((double)bytes * history.size() / history.getBytes());
+    }
+}
+
+TerminalGraph::TerminalGraph(int w, int h, int minutes, const ChannelRegistry* channel_names) 
+    : width(w), height(h), plot_style(PlotStyle::BLOCKS), channels(channel_names), state(nullptr),
+      time_window_minutes(minutes), last_data_time(0),
+      frame(w, h), output_fd(STDOUT_FILENO), render_time(0), window_start(0), window_ns(0), paused(false),
+      view_end(0), view_span(0) {
     calculateMaxPoints();
-    // Reserve space for efficiency
-    data_points.reserve(max_points);
-    timestamps.reserve(max_points);
+    series.reserve(ChannelRegistry::MAX_CHANNELS);
+}
+
+void TerminalGraph::addDataPoint(double value, uint16_t channel) {
+    addDataPoint(value, channel, getCurrentTimeNs());
 }
 
-void TerminalGraph::addDataPoint(double value) {
-    long long current_time = getCurrentTimeMs();
+void TerminalGraph::addDataPoint(double value, uint16_t channel, long long timestamp_ns) {
+    if (channel >= ChannelRegistry::MAX_CHANNELS) {
+        return;
+    }
+    if (channel >= series.size() || !series[channel].active) {
+        activateSeries(channel);
+    }
     
-    data_points.push_back(value);
-    timestamps.push_back(current_time);
+    Series& s = series[channel];
     
-    // Update interval calculation
-    updateInterval();
+    // Keep each series ordered in time so columns can be found by binary search
+    if (!s.samples.empty() && timestamp_ns < s.samples.backTimestamp()) {
+        timestamp_ns = s.samples.backTimestamp();
+    }
+    last_data_time = timestamp_ns;
     
-    // Remove old points based on time window or max points
+    // The ring evicts the oldest point itself once max_points is reached;
+    // in time-window mode that point moves to the compressed history
+    if (s.samples.full() && history_bytes > 0) {
+        s.history.append(s.samples.frontTimestamp() / NS_PER_MS, s.samples.value(0));
+    }
+    s.samples.push(value, timestamp_ns);
+    s.extremes.push(value);
+    s.rollups.add(timestamp_ns, value);
     if (time_window_minutes > 0) {
-        // Remove points older than time window
-        long long cutoff_time = current_time - (time_window_minutes * 60 * 1000);
-        while (!timestamps.empty() && timestamps[0] < cutoff_time) {
-            data_points.erase(data_points.begin());
-            timestamps.erase(timestamps.begin());
+        s.tree.set(s.samples.physicalIndex(s.samples.size() - 1), value);
+    }
+    if (plot_style == PlotStyle::HEATMAP) {
+        // New time buckets start at the current autoscale range
+        s.density.add(timestamp_ns, value, s.min_value, s.max_value);
+    }
+    
+    // Update interval calculation
+    updateInterval(s);
+    
+    expireOldPoints(s, timestamp_ns);
+    updateMinMax(s);
+}
+
+void TerminalGraph::activateSeries(uint16_t channel) {
+    if (channel >= series.size()) {
+        series.resize(channel + 1);
+    }
+    Series& s = series[channel];
+    
+    if (state) {
+        // The ring lives in the state file; a channel new to it starts empty
+        StateFile::ChannelRecord& record = state->getChannel(channel);
+        if (!record.active) {
+            std::string name = channels ? channels->getName(channel) : std::string();
+            std::memset(&record, 0, sizeof(record));
+            std::memcpy(record.name, name.data(), std::min(name.size(), sizeof(record.name) - 1));
+            record.active = 1;
+        }
+        s.samples.attach(state->getValues(channel), state->getTimestamps(channel), &record.cursor,
+                         state->getCapacity());
+        
+        // Drop what expired while the monitor was down, O(log n)
+        if (time_window_minutes > 0) {
+            long long cutoff = getCurrentTimeNs() - time_window_minutes * 60 * NS_PER_SECOND;
+            s.samples.popFront(s.samples.lowerBound(cutoff));
         }
     } else {
-        // Remove old points if we exceed maximum
-        if (data_points.size() > max_points) {
-            data_points.erase(data_points.begin());
-            timestamps.erase(timestamps.begin());
+        s.samples.setCapacity(max_points);
+    }
+    
+    // Index whatever the ring already holds
+    s.extremes.reset(max_points);
+    s.rollups.clear();
+    for (size_t i = 0; i < s.samples.size(); ++i) {
+        s.extremes.push(s.samples.value(i));
+        s.rollups.add(s.samples.timestamp(i), s.samples.value(i));
+    }
+    if (time_window_minutes > 0) {
+        s.history.setLimit(history_bytes);
+    }
+    rebuildTree(s);
+    updateInterval(s);
+    updateMinMax(s);
+    rebuildDensity(s);
+    s.active = true;
+}
+
+void TerminalGraph::attachState(StateFile* state_file) {
+    state = state_file;
+    calculateMaxPoints();
+    
+    // Saved series are back on screen at once; those that expired entirely
+    // keep their slot until their channel sends again
+    for (uint16_t channel = 0; channel < ChannelRegistry::MAX_CHANNELS; ++channel) {
+        if (state->getChannel(channel).active) {
+            activateSeries(channel);
+            if (series[channel].samples.empty()) {
+                series[channel].active = false;
+            } else {
+                last_data_time = std::max(last_data_time, series[channel].samples.backTimestamp());
+            }
         }
     }
+}
+
+void TerminalGraph::expireOldPoints(Series& s, long long current_time) {
+    if (time_window_minutes <= 0) {
+        return;
+    }
     
-    updateMinMax();
+    // Remove points older than the time window
+    long long cutoff_time = current_time - time_window_minutes * 60 * NS_PER_SECOND;
+    while (!s.samples.empty() && s.samples.frontTimestamp() < cutoff_time) {
+        s.samples.popFront();
+        s.extremes.popFront();
+    }
+    s.history.expire(cutoff_time / NS_PER_MS);
 }
 
-void TerminalGraph::updateMinMax() {
-    if (data_points.empty()) {
-        min_value = 0;
-        max_value = 100;
+void TerminalGraph::updateMinMax(Series& s) {
+    if (s.samples.empty()) {
+        s.min_value = 0;
+        s.max_value = 100;
         return;
     }
     
-    auto minmax = std::minmax_element(data_points.begin(), data_points.end());
-    min_value = *minmax.first;
-    max_value = *minmax.second;
+    double low = s.extremes.min();
+    double high = s.extremes.max();
+    
+    // History expires by whole blocks, so its extremes may briefly include
+    // a few points just outside the window
+    double history_min, history_max;
+    if (s.history.getExtremes(history_min, history_max)) {
+        low = std::min(low, history_min);
+        high = std::max(high, history_max);
+    }
+    setRange(s, low, high);
+}
+
+void TerminalGraph::setRange(Series& s, double low, double high) {
+    s.min_value = low;
+    s.max_value = high;
     
     // Add some padding to make the graph more readable
-    double range = max_value - min_value;
+    double range = s.max_value - s.min_value;
     if (range < 0.001) { // Handle case where all values are the same
-        range = std::max(1.0, std::abs(max_value) * 0.1);
-        min_value -= range / 2;
-        max_value += range / 2;
+        range = std::max(1.0, std::abs(s.max_value) * 0.1);
+        s.min_value -= range / 2;
+        s.max_value += range / 2;
     } else {
         double padding = range * 0.1;
-        min_value -= padding;
-        max_value += padding;
+        s.min_value -= padding;
+        s.max_value += padding;
     }
 }
 
-char TerminalGraph::getBarChar(double value, double row_min, double row_max) const {
+void TerminalGraph::fitViewRange(Series& s) {
+    // A view away from the default window scales to what it shows, which
+    // may be far older than the extremes kept for the live window
+    int columns = getGraphWidth() * (plot_style == PlotStyle::BRAILLE ? BRAILLE_DOTS_X : 1);
+    summarizeColumns(s, window_start, window_ns, columns);
+    bool found = false;
+    double low = 0;
+    double high = 0;
+    for (const ColumnSummary& summary : column_summaries) {
+        if (summary.count == 0) {
+            continue;
+        }
+        low = found ? std::min(low, summary.min_value) : summary.min_value;
+        high = found ? std::max(high, summary.max_value) : summary.max_value;
+        found = true;
+    }
+    if (found) {
+        setRange(s, low, high);
+    }
+}
+
+uint32_t TerminalGraph::getBarGlyph(double value, double row_min, double row_max) const {
     if (value < row_min || value > row_max) {
         return ' ';
     }
     
-    // Different characters for different intensities
+    // Any part of an eighth shows that eighth
     double intensity = (value - row_min) / (row_max - row_min);
-    
-    if (intensity > 0.875) return '█';
-    if (intensity > 0.75)  return '▇';
-    if (intensity > 0.625) return '▆';
-    if (intensity > 0.5)   return '▅';
-    if (intensity > 0.375) return '▄';
-    if (intensity > 0.25)  return '▃';
-    if (intensity > 0.125) return '▂';
-    if (intensity > 0)     return '▁';
-    
-    return ' ';
+    int eighths = (int)std::ceil(intensity * 8);
+    return BAR_GLYPHS[std::min(8, std::max(0, eighths))];
 }
 
 std::string TerminalGraph::formatValue(double value) const {
@@ -99,119 +292,612 @@ std::string TerminalGraph::formatValue(double value) const {
     return oss.str();
 }
 
-void TerminalGraph::render() const {
-    // Calculate the graph area dimensions first
-    int graph_width = width - 12; // Leave more space for Y-axis labels
-    int graph_height = height - 7; // Leave space for header, footer and margins
+std::string TerminalGraph::formatSpan(long long span_ns) const {
+    std::ostringstream oss;
+    long long seconds = (span_ns + NS_PER_SECOND / 2) / NS_PER_SECOND;
+    if (seconds < 120 && (seconds < 60 || seconds % 60 != 0)) {
+        oss << seconds << "s";
+    } else if (seconds < 120 * 60) {
+        oss << (seconds + 30) / 60 << "m";
+    } else if (seconds % 3600 == 0) {
+        oss << seconds / 3600 << "h";
+    } else {
+        oss << std::fixed << std::setprecision(1) << seconds / 3600.0 << "h";
+    }
+    return oss.str();
+}
+
+void TerminalGraph::render() {
+    // The span to draw: the -m window up to now unless the view was moved
+    render_time = getCurrentTimeNs();
+    window_ns = view_span > 0 ? view_span : getDefaultSpan();
+    window_start = (paused ? view_end : render_time) - window_ns;
     
-    // Ensure minimum graph size
-    if (graph_width < 20) graph_width = 20;
-    if (graph_height < 5) graph_height = 5;
+    // Quiet channels only expire here, since they get no new points
+    std::vector<uint16_t> visible;
+    for (size_t i = 0; i < series.size(); ++i) {
+        if (series[i].active) {
+            expireOldPoints(series[i], render_time);
+            updateMinMax(series[i]);
+            if (paused || view_span > 0) {
+                fitViewRange(series[i]);
+            }
+            visible.push_back((uint16_t)i);
+        }
+    }
+    
+    // Compose the whole frame off-screen, then emit only what changed
+    frame.clear();
     
-    // Clear the area we're going to draw
-    int total_lines = graph_height + 6; // header(3) + graph + footer(2) + margin
-    for (int i = 0; i < total_lines; ++i) {
-        std::cout << "\033[K\n"; // Clear line and move to next
+    // Stack as many panes as fit, each with a usable graph height
+    int pane_rows = height - 3; // Title, x-axis labels and bottom margin
+    size_t max_panes = std::max(1, pane_rows / (PANE_CHROME_ROWS + MIN_PANE_GRAPH_ROWS));
+    size_t hidden = 0;
+    if (visible.size() > max_panes) {
+        hidden = visible.size() - max_panes;
+        visible.resize(max_panes);
     }
-    std::cout << "\033[" << total_lines << "A"; // Move cursor back up
     
     // Title - keep it short to fit in terminal width
-    std::cout << "\033[1m" << "UDP Graph";
-    if (time_window_minutes > 0) {
-        std::cout << " (" << time_window_minutes << "m)";
+    std::ostringstream title;
+    title << "UDP Graph";
+    if (view_span > 0) {
+        title << " (" << formatSpan(view_span) << ")";
+    } else if (time_window_minutes > 0) {
+        title << " (" << time_window_minutes << "m)";
+    }
+    if (paused) {
+        title << " PAUSED";
+    }
+    if (hidden > 0) {
+        title << " +" << hidden << " more";
+    }
+    frame.text(0, 0, title.str(), FrameBuffer::DEFAULT_COLOR, true);
+    if (!status_text.empty()) {
+        frame.text((int)title.str().size() + 1, 0, status_text);
+    }
+    
+    if (visible.empty()) {
+        std::ostringstream status;
+        status << "Pts:0/" << max_points + history_bytes / HISTORY_BYTES_PER_POINT;
+        frame.text(0, 1, status.str());
+        frame.text(0, 3, "Waiting for data...");
+        if (!footer_text.empty()) {
+            frame.text(0, height - 1, footer_text);
+        }
+        frame.present(output_fd);
+        return;
+    }
+    
+    int graph_bottom;
+    if (visible.size() == 1 && visible[0] == ChannelRegistry::DEFAULT_CHANNEL) {
+        // Single unnamed series keeps the classic layout with a blank spacer row
+        int graph_height = std::max(5, height - 7);
+        renderPane(series[visible[0]], "", 1, 3, graph_height, PANE_COLORS[0][0], PANE_COLORS[0][1]);
+        graph_bottom = 3 + graph_height;
+    } else {
+        int pane_height = pane_rows / (int)visible.size();
+        int graph_height = pane_height - PANE_CHROME_ROWS;
+        int top = 1;
+        for (size_t i = 0; i < visible.size(); ++i) {
+            uint16_t channel = visible[i];
+            std::string name = channels ? channels->getName(channel) : std::string();
+            if (name.empty()) {
+                name = channel == ChannelRegistry::DEFAULT_CHANNEL ? "value" : "ch" + std::to_string(channel);
+            }
+            const int16_t* colors = PANE_COLORS[i % PANE_COLOR_COUNT];
+            renderPane(series[channel], name, top, top + 1, graph_height, colors[0], colors[1]);
+            top += pane_height;
+        }
+        graph_bottom = top - 1;
+    }
+    
+    // X-axis labels (time indicators) - shortened to fit
+    int graph_width = std::max(20, width - 12);
+    if (graph_width >= 15) {
+        int middle_pos = graph_width / 2 - 1;
+        if (paused || view_span > 0) {
+            // Both edges as the time before now
+            long long end_age = render_time - (window_start + window_ns);
+            frame.text(7, graph_bottom + 1, "-" + formatSpan(end_age + window_ns));
+            frame.text(7 + middle_pos, graph_bottom + 1, "|");
+            frame.text(graph_width + 4, graph_bottom + 1, end_age >= NS_PER_SECOND ? "-" + formatSpan(end_age) : "now");
+        } else if (time_window_minutes > 0) {
+            // Columns span the whole window, so label it in time
+            std::string start_label = "-" + std::to_string(time_window_minutes) + "m";
+            frame.text(7, graph_bottom + 1, start_label);
+            frame.text(7 + middle_pos, graph_bottom + 1, "|");
+            frame.text(graph_width + 4, graph_bottom + 1, "now");
+        } else {
+            frame.text(7, graph_bottom + 1, "old");
+            frame.text(7 + middle_pos, graph_bottom + 1, "|");
+            frame.text(graph_width + 4, graph_bottom + 1, "new");
+        }
+    }
+    
+    // The bottom row is kept free by both layouts
+    if (!footer_text.empty()) {
+        frame.text(0, height - 1, footer_text);
     }
-    std::cout << "\033[0m" << std::endl;
+    
+    frame.present(output_fd);
+}
+
+void TerminalGraph::renderPane(const Series& s, const std::string& name, int status_y, int graph_top,
+                               int graph_height, int16_t high_color, int16_t low_color) {
+    int graph_width = width - 12; // Leave more space for Y-axis labels
+    
+    // Ensure minimum graph size
+    if (graph_width < 20) graph_width = 20;
     
     // Status line - truncated to fit terminal width
-    std::cout << "Pts:" << data_points.size() << "/" << max_points;
-    if (!data_points.empty()) {
-        std::cout << " Range:" << formatValue(min_value) << "-" << formatValue(max_value);
-        std::cout << " Last:" << formatValue(data_points.back());
-        if (avg_interval_seconds > 0) {
-            std::cout << " Int:" << std::fixed << std::setprecision(1) << avg_interval_seconds << "s";
+    std::ostringstream status;
+    if (!name.empty()) {
+        status << name << " ";
+    }
+    status << "Pts:" << s.samples.size() + s.history.size() << "/"
+           << max_points + historyCapacity(s.history, history_bytes);
+    if (!s.history.empty()) {
+        status << " Hist:" << std::fixed << std::setprecision(1)
+               << double(s.history.getBytes()) / s.history.size() << "B/pt";
+    }
+    if (!s.samples.empty()) {
+        status << " Range:" << formatValue(s.min_value) << "-" << formatValue(s.max_value);
+        status << " Last:" << formatValue(s.samples.backValue());
+        double mean;
+        if ((paused || view_span > 0) &&
+            s.rollups.getMean(window_start, window_start + window_ns, window_ns / graph_width, mean)) {
+            status << " Mean:" << formatValue(mean);
+        }
+        if (s.avg_interval_seconds > 0) {
+            if (s.avg_interval_seconds < 1) {
+                status << " Int:" << std::fixed << std::setprecision(1) << s.avg_interval_seconds * 1000 << "ms";
+            } else {
+                status << " Int:" << std::fixed << std::setprecision(1) << s.avg_interval_seconds << "s";
+            }
         }
     }
-    std::cout << std::endl << std::endl;
+    if (name.empty()) {
+        frame.text(0, status_y, status.str());
+    } else {
+        frame.text(0, status_y, name, high_color, true);
+        frame.text((int)name.size(), status_y, status.str().substr(name.size()));
+    }
     
-    if (data_points.empty()) {
-        std::cout << "Waiting for data..." << std::endl;
-        return;
+    // Y-axis labels
+    for (int row = 0; row < graph_height; ++row) {
+        double row_max = s.max_value - (double(row) / graph_height) * (s.max_value - s.min_value);
+        double row_min = s.max_value - (double(row + 1) / graph_height) * (s.max_value - s.min_value);
+        std::ostringstream label;
+        label << std::setw(8) << std::right << formatValue((row_max + row_min) / 2) << " |";
+        frame.text(0, graph_top + row, label.str());
+    }
+    
+    // The density grid only holds the -m window at its own column width, so
+    // a zoomed heatmap falls back to columns
+    if (plot_style == PlotStyle::HEATMAP && time_window_minutes > 0 && window_ns == getDefaultSpan()) {
+        renderHeatmap(s, graph_top, graph_height, graph_width);
+    } else if (plot_style == PlotStyle::BRAILLE) {
+        if (window_ns > 0) {
+            renderWindowDots(s, graph_top, graph_height, graph_width, high_color, low_color);
+        } else {
+            renderLatestDots(s, graph_top, graph_height, graph_width, high_color, low_color);
+        }
+    } else if (window_ns > 0) {
+        renderWindowColumns(s, graph_top, graph_height, graph_width, high_color, low_color);
+    } else {
+        renderLatestColumns(s, graph_top, graph_height, graph_width, high_color, low_color);
     }
     
-    // Draw the graph from top to bottom
+    // X-axis
+    int axis_y = graph_top + graph_height;
+    frame.text(6, axis_y, "+");
+    for (int i = 0; i < graph_width; ++i) {
+        frame.put(7 + i, axis_y, '-');
+    }
+}
+
+void TerminalGraph::renderLatestColumns(const Series& s, int graph_top, int graph_height, int graph_width,
+                                        int16_t high_color, int16_t low_color) {
+    // Draw the graph from top to bottom, one sample per column
+    const int graph_left = 10;
+    const double min_value = s.min_value;
+    const double max_value = s.max_value;
+    int point_count = (int)s.samples.size();
     for (int row = 0; row < graph_height; ++row) {
+        int y = graph_top + row;
+        
         // Calculate the value range for this row
         double row_max = max_value - (double(row) / graph_height) * (max_value - min_value);
         double row_min = max_value - (double(row + 1) / graph_height) * (max_value - min_value);
         
-        // Y-axis label
-        std::cout << std::setw(8) << std::right << formatValue((row_max + row_min) / 2) << " |";
+        // Draw the graph points, newest sample in the rightmost column
+        for (int col = 0; col < graph_width && col < point_count; ++col) {
+            int data_index = point_count - graph_width + col;
+            if (data_index < 0) {
+                continue;
+            }
+            
+            double value = s.samples.value(data_index);
+            uint32_t glyph = getBarGlyph(value, row_min, row_max);
+            if (glyph == ' ') {
+                continue;
+            }
+            
+            // Color coding based on value: high and low values get the pane's two colors
+            int16_t color = value > (max_value + min_value) / 2 ? high_color : low_color;
+            frame.put(graph_left + col, y, glyph, color);
+        }
+    }
+}
+
+void TerminalGraph::summarizeColumns(const Series& s, long long start, long long span, int columns) {
+    column_summaries.resize(columns);
+    for (ColumnSummary& summary : column_summaries) {
+        summary.reset();
+    }
+    
+    // Whatever predates the raw points comes from the rollups, then older
+    // points from the compressed history and the rest from the ring
+    long long raw_start = getRawStart(s);
+    if (start < raw_start) {
+        s.rollups.summarize(start, span, raw_start, column_summaries.data(), columns);
+    }
+    s.history.summarize(start / NS_PER_MS, span / NS_PER_MS, column_summaries.data(), columns);
+    
+    // Column boundaries are found by binary search and each column's
+    // extremes come from the tree, so this is O(columns * log n). Points
+    // stamped after the frame land in the last column of a live view.
+    const SampleRing& samples = s.samples;
+    size_t begin = samples.lowerBound(start);
+    size_t stop = start + span >= render_time ? samples.size() : samples.lowerBound(start + span);
+    for (int col = 0; col < columns; ++col) {
+        long long column_end = start + span * (col + 1) / columns;
+        size_t end = col == columns - 1 ? stop : samples.lowerBound(column_end);
         
-        // Draw the graph points
-        for (int col = 0; col < graph_width; ++col) {
-            if (col < data_points.size()) {
-                int data_index = data_points.size() - graph_width + col;
-                if (data_index >= 0) {
-                    double value = data_points[data_index];
-                    char bar_char = getBarChar(value, row_min, row_max);
-                    
-                    // Color coding based on value
-                    if (bar_char != ' ') {
-                        if (value > (max_value + min_value) / 2) {
-                            std::cout << "\033[32m"; // Green for high values
-                        } else {
-                            std::cout << "\033[36m"; // Cyan for low values
-                        }
-                        std::cout << bar_char << "\033[0m";
-                    } else {
-                        std::cout << ' ';
-                    }
-                } else {
-                    std::cout << ' ';
-                }
+        ColumnSummary summary;
+        summary.count = end - begin;
+        if (summary.count > 0 && time_window_minutes <= 0) {
+            // Latest-values rings are a screen wide and have no tree
+            summary.count = 0;
+            for (size_t i = begin; i < end; ++i) {
+                summary.add(samples.value(i));
+            }
+            column_summaries[col].merge(summary);
+        } else if (summary.count > 0) {
+            summary.first = samples.value(begin);
+            summary.last = samples.value(end - 1);
+            
+            // The logical range maps to at most two physical slot ranges
+            size_t first_slot = samples.physicalIndex(begin);
+            size_t last_slot = samples.physicalIndex(end - 1);
+            if (first_slot <= last_slot) {
+                s.tree.query(first_slot, last_slot + 1, summary.min_value, summary.max_value);
             } else {
-                std::cout << ' ';
+                double lo, hi;
+                s.tree.query(first_slot, samples.capacity(), summary.min_value, summary.max_value);
+                s.tree.query(0, last_slot + 1, lo, hi);
+                summary.min_value = std::min(summary.min_value, lo);
+                summary.max_value = std::max(summary.max_value, hi);
             }
+            column_summaries[col].merge(summary);
         }
-        std::cout << std::endl;
+        begin = end;
     }
+}
+
+void TerminalGraph::renderWindowColumns(const Series& s, int graph_top, int graph_height, int graph_width,
+                                        int16_t high_color, int16_t low_color) {
+    // Map the whole time window onto the columns and draw each column as the
+    // span of its samples (M4: min, max, first, last), joined to the
+    // previous column's last value so the trace stays continuous
+    const int graph_left = 10;
+    summarizeColumns(s, window_start, window_ns, graph_width);
     
-    // X-axis
-    std::cout << "      +";
-    for (int i = 0; i < graph_width; ++i) {
-        std::cout << "-";
+    const double min_value = s.min_value;
+    const double max_value = s.max_value;
+    bool have_previous = false;
+    double previous_last = 0;
+    
+    for (int col = 0; col < graph_width; ++col) {
+        const ColumnSummary& summary = column_summaries[col];
+        if (summary.count == 0) {
+            have_previous = false;
+            continue;
+        }
+        
+        double span_low = summary.min_value;
+        double span_high = summary.max_value;
+        if (have_previous) {
+            span_low = std::min(span_low, std::min(previous_last, summary.first));
+            span_high = std::max(span_high, std::max(previous_last, summary.first));
+        }
+        have_previous = true;
+        previous_last = summary.last;
+        
+        // Color by where the column ends up
+        int16_t color = summary.last > (max_value + min_value) / 2 ? high_color : low_color;
+        
+        for (int row = 0; row < graph_height; ++row) {
+            double row_max = max_value - (double(row) / graph_height) * (max_value - min_value);
+            double row_min = max_value - (double(row + 1) / graph_height) * (max_value - min_value);
+            if (span_high < row_min || span_low > row_max) {
+                continue;
+            }
+            
+            // The top of the span gets a partial block, the rest is filled
+            uint32_t glyph = span_high <= row_max ? getBarGlyph(span_high, row_min, row_max) : 0x2588;
+            if (glyph != ' ') {
+                frame.put(graph_left + col, graph_top + row, glyph, color);
+            }
+        }
     }
-    std::cout << std::endl;
+}
+
+void TerminalGraph::renderLatestDots(const Series& s, int graph_top, int graph_height, int graph_width,
+                                     int16_t high_color, int16_t low_color) {
+    // One sample per dot column, two per cell, each joined to the previous
+    // sample so the line stays continuous
+    dot_masks.assign((size_t)graph_width * graph_height, 0);
+    dot_colors.assign(dot_masks.size(), FrameBuffer::DEFAULT_COLOR);
     
-    // X-axis labels (time indicators) - shortened to fit
-    std::cout << "       ";
-    if (graph_width >= 15) {
-        std::cout << "old";
-        int middle_pos = graph_width / 2 - 1;
-        for (int i = 3; i < middle_pos; ++i) {
-            std::cout << " ";
+    const double middle = (s.max_value + s.min_value) / 2;
+    int dot_columns = graph_width * BRAILLE_DOTS_X;
+    int point_count = (int)s.samples.size();
+    for (int dot_x = 0; dot_x < dot_columns; ++dot_x) {
+        int data_index = point_count - dot_columns + dot_x;
+        if (data_index < 0) {
+            continue;
         }
-        std::cout << "|";
-        for (int i = middle_pos + 1; i < graph_width - 3; ++i) {
-            std::cout << " ";
+        
+        double value = s.samples.value(data_index);
+        double low = value;
+        double high = value;
+        if (data_index > 0) {
+            double previous = s.samples.value(data_index - 1);
+            low = std::min(low, previous);
+            high = std::max(high, previous);
         }
-        if (graph_width >= graph_width - 3) {
-            std::cout << "new";
+        plotDots(s, dot_x, low, high, graph_height, graph_width, value > middle ? high_color : low_color);
+    }
+    presentDots(graph_top, graph_height, graph_width);
+}
+
+void TerminalGraph::renderWindowDots(const Series& s, int graph_top, int graph_height, int graph_width,
+                                     int16_t high_color, int16_t low_color) {
+    // Same M4 spans as renderWindowColumns, at two columns per cell
+    dot_masks.assign((size_t)graph_width * graph_height, 0);
+    dot_colors.assign(dot_masks.size(), FrameBuffer::DEFAULT_COLOR);
+    
+    int dot_columns = graph_width * BRAILLE_DOTS_X;
+    summarizeColumns(s, window_start, window_ns, dot_columns);
+    
+    const double middle = (s.max_value + s.min_value) / 2;
+    bool have_previous = false;
+    double previous_last = 0;
+    for (int dot_x = 0; dot_x < dot_columns; ++dot_x) {
+        const ColumnSummary& summary = column_summaries[dot_x];
+        if (summary.count == 0) {
+            have_previous = false;
+            continue;
+        }
+        
+        double span_low = summary.min_value;
+        double span_high = summary.max_value;
+        if (have_previous) {
+            span_low = std::min(span_low, std::min(previous_last, summary.first));
+            span_high = std::max(span_high, std::max(previous_last, summary.first));
+        }
+        have_previous = true;
+        previous_last = summary.last;
+        
+        int16_t color = summary.last > middle ? high_color : low_color;
+        plotDots(s, dot_x, span_low, span_high, graph_height, graph_width, color);
+    }
+    presentDots(graph_top, graph_height, graph_width);
+}
+
+void TerminalGraph::plotDots(const Series& s, int dot_x, double low, double high, int graph_height,
+                             int graph_width, int16_t color) {
+    // Dot rows count down from the top of the pane; the autoscale padding
+    // keeps values inside, the clamp only guards rounding at the edges
+    int dot_rows = graph_height * BRAILLE_DOTS_Y;
+    double scale = dot_rows / (s.max_value - s.min_value);
+    int top = std::min(dot_rows - 1, std::max(0, (int)((s.max_value - high) * scale)));
+    int bottom = std::min(dot_rows - 1, std::max(0, (int)((s.max_value - low) * scale)));
+    
+    // Set the run one cell at a time, a table lookup per cell
+    const uint8_t (*spans)[BRAILLE_DOTS_Y] = BRAILLE_SPAN[dot_x % BRAILLE_DOTS_X];
+    int col = dot_x / BRAILLE_DOTS_X;
+    int first_row = top / BRAILLE_DOTS_Y;
+    int last_row = bottom / BRAILLE_DOTS_Y;
+    for (int row = first_row; row <= last_row; ++row) {
+        int first = row == first_row ? top % BRAILLE_DOTS_Y : 0;
+        int last = row == last_row ? bottom % BRAILLE_DOTS_Y : BRAILLE_DOTS_Y - 1;
+        size_t cell = (size_t)row * graph_width + col;
+        dot_masks[cell] |= spans[first][last];
+        dot_colors[cell] = color; // The right half wins a shared cell
+    }
+}
+
+void TerminalGraph::presentDots(int graph_top, int graph_height, int graph_width) {
+    const int graph_left = 10;
+    for (int row = 0; row < graph_height; ++row) {
+        const size_t row_start = (size_t)row * graph_width;
+        for (int col = 0; col < graph_width; ++col) {
+            uint8_t mask = dot_masks[row_start + col];
+            if (mask != 0) {
+                frame.put(graph_left + col, graph_top + row, BRAILLE_BASE + mask, dot_colors[row_start + col]);
+            }
         }
     }
-    std::cout << std::endl;
+}
+
+void TerminalGraph::renderHeatmap(const Series& s, int graph_top, int graph_height, int graph_width) {
+    // Each column is a time bucket and each row a value range, colored by
+    // how many samples fell there. The counts are kept per sample by the
+    // density grid, so a frame costs O(columns * rows) however fast data comes.
+    const int graph_left = 10;
+    heat_cells.assign((size_t)graph_width * graph_height, 0);
+    double row_height = (s.max_value - s.min_value) / graph_height;
+    long long newest = s.density.bucketOf(window_start + window_ns);
+    
+    float densest = 0;
+    for (int col = 0; col < graph_width; ++col) {
+        float* cells = &heat_cells[(size_t)col * graph_height];
+        s.density.spread(newest - (graph_width - 1 - col), s.max_value, row_height, graph_height, cells);
+        for (int row = 0; row < graph_height; ++row) {
+            densest = std::max(densest, cells[row]);
+        }
+    }
+    if (densest <= 0) {
+        return;
+    }
+    
+    // Log scale, so sparse outliers stay visible next to the dense band
+    double scale = (HEAT_LEVELS - 1) / std::log1p(densest);
+    for (int col = 0; col < graph_width; ++col) {
+        const float* cells = &heat_cells[(size_t)col * graph_height];
+        for (int row = 0; row < graph_height; ++row) {
+            if (cells[row] > 0) {
+                int level = std::min(HEAT_LEVELS - 1, (int)(std::log1p(cells[row]) * scale + 0.5));
+                frame.put(graph_left + col, graph_top + row, 0x2588, HEAT_RAMP[level]);
+            }
+        }
+    }
+}
+
+void TerminalGraph::rebuildDensity(Series& s) {
+    if (plot_style != PlotStyle::HEATMAP || time_window_minutes <= 0) {
+        return;
+    }
+    
+    // One time bucket per graph column; refill from everything retained
+    int columns = getGraphWidth();
+    s.density.reset(columns, time_window_minutes * 60 * NS_PER_SECOND / columns);
+    Series* target = &s;
+    s.history.forEach([target](long long timestamp_ms, double value) {
+        target->density.add(timestamp_ms * NS_PER_MS, value, target->min_value, target->max_value);
+    });
+    for (size_t i = 0; i < s.samples.size(); ++i) {
+        s.density.add(s.samples.timestamp(i), s.samples.value(i), s.min_value, s.max_value);
+    }
+}
+
+long long TerminalGraph::getRawStart(const Series& s) const {
+    if (!s.history.empty()) {
+        return s.history.frontTimestamp() * NS_PER_MS;
+    }
+    return s.samples.empty() ? LLONG_MAX : s.samples.frontTimestamp();
+}
+
+long long TerminalGraph::getDefaultSpan() const {
+    return time_window_minutes * 60 * NS_PER_SECOND;
+}
+
+void TerminalGraph::startBrowsing() {
+    // The latest-values mode has no time axis; the view starts at the span
+    // its rings cover
+    if (view_span > 0 || time_window_minutes > 0) {
+        return;
+    }
+    view_span = MIN_VIEW_NS;
+    for (const Series& s : series) {
+        if (s.active && s.samples.size() > 1) {
+            view_span = std::max(view_span, s.samples.backTimestamp() - s.samples.frontTimestamp());
+        }
+    }
+}
+
+void TerminalGraph::togglePause() {
+    if (paused) {
+        paused = false;
+        return;
+    }
+    startBrowsing();
+    paused = true;
+    view_end = getCurrentTimeNs();
+}
+
+void TerminalGraph::zoom(double factor) {
+    startBrowsing();
+    long long span = view_span > 0 ? view_span : getDefaultSpan();
+    long long zoomed = (long long)(span * factor);
+    zoomed = std::min(RollupTiers::getRetentionNs(), std::max(MIN_VIEW_NS, zoomed));
+    if (paused) {
+        long long middle = view_end - span / 2;
+        view_end = std::min(getCurrentTimeNs(), middle + zoomed / 2);
+    }
+    view_span = zoomed == getDefaultSpan() ? 0 : zoomed;
+}
+
+void TerminalGraph::pan(double fraction) {
+    startBrowsing();
+    long long now = getCurrentTimeNs();
+    if (!paused) {
+        paused = true;
+        view_end = now;
+    }
+    long long span = view_span > 0 ? view_span : getDefaultSpan();
+    view_end += (long long)(span * fraction);
+    view_end = std::min(now, std::max(now - RollupTiers::getRetentionNs(), view_end));
+}
+
+void TerminalGraph::resetView() {
+    paused = false;
+    view_span = 0;
+}
+
+int TerminalGraph::getGraphWidth() const {
+    // Leave space for the Y-axis labels
+    return std::max(20, width - 12);
+}
+
+void TerminalGraph::rebuildTree(Series& s) {
+    if (time_window_minutes <= 0) {
+        return;
+    }
+    s.tree.reset(s.samples.capacity());
+    for (size_t i = 0; i < s.samples.size(); ++i) {
+        s.tree.set(s.samples.physicalIndex(i), s.samples.value(i));
+    }
 }
 
 void TerminalGraph::clear() {
-    data_points.clear();
-    timestamps.clear();
-    min_value = 0;
-    max_value = 100;
-    avg_interval_seconds = 1.0;
+    series.clear();
     last_data_time = 0;
 }
 
+size_t TerminalGraph::getDataPointCount() const {
+    size_t total = 0;
+    for (const Series& s : series) {
+        total += s.samples.size() + s.history.size();
+    }
+    return total;
+}
+
+size_t TerminalGraph::getSeriesCount() const {
+    size_t count = 0;
+    for (const Series& s : series) {
+        if (s.active) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+double TerminalGraph::getAvgInterval(uint16_t channel) const {
+    return channel < series.size() ? series[channel].avg_interval_seconds : 1.0;
+}
+
 void TerminalGraph::calculateMaxPoints() {
+    if (state) {
+        // State file rings hold the whole window uncompressed
+        max_points = state->getCapacity();
+        history_bytes = 0;
+        return;
+    }
+    
     if (time_window_minutes > 0) {
         // For time-based mode, allow many more points
         // They'll be filtered by time window in addDataPoint
@@ -219,54 +905,81 @@ void TerminalGraph::calculateMaxPoints() {
     } else {
         // Auto-detect based on terminal width (original behavior)
         max_points = width - 12;
+        if (plot_style == PlotStyle::BRAILLE) {
+            max_points *= BRAILLE_DOTS_X;
+        }
     }
     
     // Ensure reasonable bounds
     if (max_points < 20) max_points = 20;
-    if (max_points > 10000) max_points = 10000; // Reasonable memory limit
+    if (max_points > MAX_RING_POINTS) max_points = MAX_RING_POINTS; // Reasonable memory limit
+    
+    // Points beyond the ring are kept compressed, so faster senders still
+    // fill more of the time window
+    history_bytes = time_window_minutes > 0 ? HISTORY_BYTES : 0;
 }
 
-long long TerminalGraph::getCurrentTimeMs() const {
-    auto now = std::chrono::high_resolution_clock::now();
-    auto duration = now.time_since_epoch();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+long long TerminalGraph::getCurrentTimeNs() const {
+    return currentTimeNs();
 }
 
-void TerminalGraph::updateInterval() {
-    if (timestamps.size() < 2) {
+void TerminalGraph::updateInterval(Series& s) {
+    const SampleRing& samples = s.samples;
+    if (samples.size() < 2) {
         return;
     }
     
     // Calculate average interval from last 10 data points
-    size_t start_idx = timestamps.size() > 10 ? timestamps.size() - 10 : 0;
+    size_t start_idx = samples.size() > 10 ? samples.size() - 10 : 0;
     double total_intervals = 0;
     int count = 0;
     
-    for (size_t i = start_idx + 1; i < timestamps.size(); ++i) {
-        double interval = (timestamps[i] - timestamps[i-1]) / 1000.0; // Convert to seconds
-        if (interval > 0.01 && interval < 300) { // Reasonable bounds: 10ms to 5 minutes
+    for (size_t i = start_idx + 1; i < samples.size(); ++i) {
+        double interval = (samples.timestamp(i) - samples.timestamp(i-1)) / 1e9; // Convert to seconds
+        if (interval > 0 && interval < 300) { // Reasonable bounds: distinct timestamps up to 5 minutes
             total_intervals += interval;
             count++;
         }
     }
     
     if (count > 0) {
-        avg_interval_seconds = total_intervals / count;
+        s.avg_interval_seconds = total_intervals / count;
     }
 }
 
+void TerminalGraph::setPlotStyle(PlotStyle style) {
+    plot_style = style;
+    calculateMaxPoints();
+    applyLayout();
+}
+
 void TerminalGraph::updateTerminalSize(int w, int h) {
     width = w;
     height = h;
+    frame.resize(width, height);
     calculateMaxPoints();
-    
-    // Resize data_points if needed (only for non-time-based mode)
-    if (time_window_minutes == 0 && data_points.size() > max_points) {
-        // Remove old points to fit new size
-        size_t to_remove = data_points.size() - max_points;
-        data_points.erase(data_points.begin(), data_points.begin() + to_remove);
-        timestamps.erase(timestamps.begin(), timestamps.begin() + to_remove);
+    applyLayout();
+}
+
+void TerminalGraph::applyLayout() {
+    for (Series& s : series) {
+        if (!s.active) {
+            continue;
+        }
+        
+        if (max_points != s.samples.capacity()) {
+            // Drops the oldest points if the ring shrinks, then rebuild the extremes
+            s.samples.setCapacity(max_points);
+            s.extremes.reset(max_points);
+            s.history.setLimit(history_bytes);
+            for (size_t i = 0; i < s.samples.size(); ++i) {
+                s.extremes.push(s.samples.value(i));
+            }
+            rebuildTree(s);
+            updateMinMax(s);
+        }
+        
+        // Density columns follow the graph width
+        rebuildDensity(s);
     }
-    data_points.reserve(max_points);
-    timestamps.reserve(max_points);
 }
@@ -3,43 +3,158 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
+#include "sample_ring.h"
+#include "minmax_window.h"
+#include "aggregation_tree.h"
+#include "compressed_history.h"
+#include "density_grid.h"
+#include "rollup_tiers.h"
+#include "state_file.h"
+#include "column_summary.h"
+#include "frame_buffer.h"
+#include "channel_registry.h"
+
+// How a pane draws its trace
+enum class PlotStyle {
+    BLOCKS, // One column per cell, eighth-block glyphs for the top of each bar
+    BRAILLE, // Line plot on the 2x4 dot grid of Braille cells (U+2800)
+    HEATMAP  // Sample density per time and value bucket, time-window mode only
+};
 
 class TerminalGraph {
 private:
+    // One channel's data and its autoscale state
+    struct Series {
+        bool active; // Has received data
+        SampleRing samples; // Values and ns timestamps (for dynamic interval)
+        MinMaxWindow extremes; // Window min/max, mirrors samples
+        AggregationTree tree; // Min/max by ring slot, time-window mode only
+        CompressedHistory history; // Points evicted from a full ring at ms resolution, time-window mode only
+        DensityGrid density; // Counts per time and value bucket, heatmap only
+        RollupTiers rollups; // 1 s/10 s/1 min/10 min summaries, for views reaching past the raw points
+        double min_value;
+        double max_value;
+        double avg_interval_seconds;
+        
+        Series() : active(false), min_value(0), max_value(100), avg_interval_seconds(1.0) {}
+    };
+    
     int width;
     int height;
-    std::vector<double> data_points;
-    std::vector<long long> timestamps; // Store timestamps for dynamic interval
-    size_t max_points;
-    double min_value;
-    double max_value;
+    std::vector<Series> series; // Indexed by channel id
+    std::vector<ColumnSummary> column_summaries; // Reused by renderWindowColumns
+    std::vector<uint8_t> dot_masks; // Braille dot bits per graph cell, reused every pane
+    std::vector<int16_t> dot_colors;
+    std::vector<float> heat_cells; // Density per graph cell, reused every pane
+    PlotStyle plot_style;
+    const ChannelRegistry* channels; // Channel names, may be null
+    StateFile* state; // Backing for the sample rings, may be null
+    size_t max_points; // Raw ring capacity per series
+    size_t history_bytes; // Compressed history kept beyond the ring, per series
     int time_window_minutes;
-    double avg_interval_seconds;
     long long last_data_time;
+    FrameBuffer frame;
+    int output_fd;
+    std::string status_text;
+    std::string footer_text;
+    long long render_time; // Wall clock time of the frame being drawn, in ns
+    long long window_start; // Time span of the frame being drawn, in ns;
+    long long window_ns;    // 0 in the latest-values mode
+    bool paused;            // The view stays put while data keeps coming in
+    long long view_end;     // Right edge of the paused view, in ns
+    long long view_span;    // Zoomed span in ns, 0 for the default
     
-    void updateMinMax();
-    char getBarChar(double value, double row_min, double row_max) const;
+    void activateSeries(uint16_t channel);
+    void updateMinMax(Series& s);
+    void setRange(Series& s, double low, double high);
+    void fitViewRange(Series& s);
+    void updateInterval(Series& s);
+    void expireOldPoints(Series& s, long long current_time);
+    void renderPane(const Series& s, const std::string& name, int status_y, int graph_top,
+                    int graph_height, int16_t high_color, int16_t low_color);
+    void renderLatestColumns(const Series& s, int graph_top, int graph_height, int graph_width,
+                             int16_t high_color, int16_t low_color);
+    void renderWindowColumns(const Series& s, int graph_top, int graph_height, int graph_width,
+                             int16_t high_color, int16_t low_color);
+    void renderLatestDots(const Series& s, int graph_top, int graph_height, int graph_width,
+                          int16_t high_color, int16_t low_color);
+    void renderWindowDots(const Series& s, int graph_top, int graph_height, int graph_width,
+                          int16_t high_color, int16_t low_color);
+    void plotDots(const Series& s, int dot_x, double low, double high, int graph_height, int graph_width,
+                  int16_t color);
+    void presentDots(int graph_top, int graph_height, int graph_width);
+    void renderHeatmap(const Series& s, int graph_top, int graph_height, int graph_width);
+    void rebuildDensity(Series& s);
+    int getGraphWidth() const;
+    void summarizeColumns(const Series& s, long long start, long long span, int columns);
+    long long getRawStart(const Series& s) const;
+    long long getDefaultSpan() const;
+    void startBrowsing();
+    void rebuildTree(Series& s);
+    uint32_t getBarGlyph(double value, double row_min, double row_max) const;
     std::string formatValue(double value) const;
+    std::string formatSpan(long long span_ns) const;
     void calculateMaxPoints();
-    void updateInterval();
-    long long getCurrentTimeMs() const;
+    void applyLayout();
+    long long getCurrentTimeNs() const;
     
 public:
-    // Constructor with terminal size detection and optional time window
-    TerminalGraph(int w, int h, int minutes = 0);
+    // Constructor with terminal size detection and optional time window.
+    // Channel names for pane titles are looked up in channels if given.
+    TerminalGraph(int w, int h, int minutes = 0, const ChannelRegistry* channels = nullptr);
+    
+    void addDataPoint(double value, uint16_t channel = ChannelRegistry::DEFAULT_CHANNEL);
+    
+    // Add a point taken at timestamp_ns (since the epoch) rather than now
+    void addDataPoint(double value, uint16_t channel, long long timestamp_ns);
     
-    void addDataPoint(double value);
-    void render() const;
+    // Text shown to the right of the title, e.g. ingest counters
+    void setStatusText(const std::string& text) { status_text = text; }
+    // Text on the bottom row, e.g. pipeline stats; empty hides it
+    void setFooterText(const std::string& text) { footer_text = text; }
+    // Draw the graph and write the changes since the last frame to the output fd
+    void render();
     void clear();
     void updateTerminalSize(int w, int h);
     
+    // Braille packs two samples per column, so the latest-values mode keeps
+    // twice as many points. The heatmap needs a time window.
+    void setPlotStyle(PlotStyle style);
+    PlotStyle getPlotStyle() const { return plot_style; }
+    
+    // Keep the sample rings in state_file, which must outlive the graph, and
+    // put the series it already holds back on screen. Call before adding data.
+    void attachState(StateFile* state_file);
+    
+    // Interactive view. Pausing freezes the window while data keeps coming
+    // in; zooming and panning work live or paused and reach back past the
+    // raw points through the rollups, at a cost that follows the width.
+    void togglePause();
+    // Multiply the span, < 1 zooms in; a paused view keeps its middle
+    void zoom(double factor);
+    // Move by a fraction of the span, negative is back in time; pauses
+    void pan(double fraction);
+    // Back to live at the default span
+    void resetView();
+    bool isPaused() const { return paused; }
+    
+    // Redirect frame output (defaults to stdout)
+    void setOutputFd(int fd) { output_fd = fd; }
+    
+    // Repaint the whole screen on the next render
+    void invalidate() { frame.invalidate(); }
+    
     // Getters
     int getWidth() const { return width; }
     int getHeight() const { return height; }
-    size_t getDataPointCount() const { return data_points.size(); }
+    size_t getDataPointCount() const;
+    size_t getSeriesCount() const;
     int getTimeWindowMinutes() const { return time_window_minutes; }
     size_t getMaxPoints() const { return max_points; }
-    double getAvgInterval() const { return avg_interval_seconds; }
+    size_t getHistoryBytes() const { return history_bytes; }
+    double getAvgInterval(uint16_t channel = ChannelRegistry::DEFAULT_CHANNEL) const;
+    size_t getLastFrameBytes() const { return frame.getLastFrameBytes(); }
 };
 
 #endif // TERMINAL_GRAPH_H
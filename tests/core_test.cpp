@@ -0,0 +1,534 @@
+// Checks for behaviour that is hard to see on screen: merge order across
+// receive shards, the handling of sender-supplied timing, the rollup tier a
+// zoom level reads, the headless window sketch, the order traffic logs
+// replay in, the compressed history's bitstream, sequence loss accounting
+// and number parsing. Run with
+// make check; exits non-zero if any check fails.
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+#include <stdint.h>
+#include <string>
+#include <unistd.h>
+#include <locale.h>
+#include "shard_merge.h"
+#include "rollup_tiers.h"
+#include "data_parser.h"
+#include "wire_format.h"
+#include "value_sketch.h"
+#include "traffic_log.h"
+#include "compressed_history.h"
+#include "sequence_tracker.h"
+#include "sample.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            ++failures; \
+        } \
+    } while (0)
+
+static void stage(ShardMerge& merge, size_t shard, const long long* timestamps, size_t count) {
+    size_t room;
+    Sample* space = merge.reserve(shard, room);
+    CHECK(room >= count);
+    for (size_t i = 0; i < count; ++i) {
+        space[i].timestamp_ns = timestamps[i];
+        space[i].value = (double)timestamps[i];
+        space[i].channel = 0;
+    }
+    merge.commit(shard, count);
+}
+
+static bool ordered(const std::vector<Sample>& samples) {
+    for (size_t i = 1; i < samples.size(); ++i) {
+        if (samples[i].timestamp_ns < samples[i - 1].timestamp_ns) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testShardsInterleaveAcrossDrains() {
+    const long long now = 1000000000000LL;
+    ShardMerge merge(2, 16);
+    std::vector<Sample> out;
+    
+    // Shard 1 is behind: its samples older than shard 0's newest arrive on
+    // a later call and must still come out in order. All are recent enough
+    // that the watermark floor does not release them.
+    const long long t = now - 1000;
+    const long long first[] = { t + 10, t + 20, t + 30, t + 40 };
+    const long long behind[] = { t + 15, t + 25 };
+    stage(merge, 0, first, 4);
+    stage(merge, 1, behind, 2);
+    merge.merge(out, now);
+    CHECK(out.size() == 4); // 10 15 20 25; 30 and 40 wait for shard 1
+    CHECK(merge.getHeldCount() == 2);
+    
+    const long long late[] = { t + 35, t + 45 };
+    stage(merge, 1, late, 2);
+    merge.merge(out, now);
+    CHECK(out.size() == 7); // 30 35 40; 45 waits for shard 0
+    
+    const long long more[] = { t + 50 };
+    stage(merge, 0, more, 1);
+    merge.merge(out, now);
+    CHECK(out.size() == 8); // 45; 50 is newer than anything shard 1 has sent
+    
+    // With shard 1 idle, the watermark is the clock less the idle delay
+    merge.merge(out, now + ShardMerge::IDLE_DELAY_NS);
+    CHECK(out.size() == 9);
+    CHECK(ordered(out));
+    CHECK(merge.getHeldCount() == 0);
+    CHECK(merge.nanosUntilDue(now) == -1);
+}
+
+static void testIdleShardReleasesAfterDelay() {
+    const long long now = 1000000000000LL;
+    ShardMerge merge(2, 16);
+    std::vector<Sample> out;
+    
+    // Shard 1 sends nothing; shard 0's recent samples wait for the idle delay
+    const long long recent[] = { now - 2 * ShardMerge::IDLE_DELAY_NS, now - 10 };
+    stage(merge, 0, recent, 2);
+    CHECK(merge.merge(out, now) == 1);
+    CHECK(merge.nanosUntilDue(now) == ShardMerge::IDLE_DELAY_NS - 10);
+    CHECK(merge.merge(out, now + ShardMerge::IDLE_DELAY_NS) == 1);
+    CHECK(ordered(out));
+}
+
+static void testLaggingShardDoesNotStallLiveOne() {
+    const long long now = 1000000000000LL;
+    const long long hour = 3600000000000LL;
+    ShardMerge merge(2, 16);
+    std::vector<Sample> out;
+    
+    // Shard 0 carries a sender backfilling an hour ago, shard 1 is live
+    const long long backfill[] = { now - hour, now - hour + 1 };
+    const long long live[] = { now - 1000, now - 500 };
+    stage(merge, 0, backfill, 2);
+    stage(merge, 1, live, 2);
+    CHECK(merge.merge(out, now) == 2); // The backfill; live waits for the idle delay
+    
+    // The backfill keeps coming, but the live samples still go out
+    const long long more_backfill[] = { now - hour + 2 };
+    stage(merge, 0, more_backfill, 1);
+    CHECK(merge.merge(out, now + ShardMerge::IDLE_DELAY_NS) == 3);
+    CHECK(merge.getHeldCount() == 0);
+    
+    // A head stamped in the future is forced out after MAX_HOLD_NS, and
+    // what queued behind it follows
+    const long long future[] = { now + 5000000000LL, now };
+    stage(merge, 0, future, 2);
+    CHECK(merge.merge(out, now) == 0);
+    CHECK(merge.nanosUntilDue(now) == ShardMerge::MAX_HOLD_NS);
+    CHECK(merge.merge(out, now + ShardMerge::MAX_HOLD_NS) == 2);
+    CHECK(merge.nanosUntilDue(now) == -1);
+}
+
+static void testFullBufferKeepsMoving() {
+    const long long now = 1000000000000LL;
+    ShardMerge merge(2, 4);
+    std::vector<Sample> out;
+    
+    const long long fill[] = { 1, 2, 3, 4 };
+    stage(merge, 0, fill, 4);
+    size_t room;
+    merge.reserve(0, room);
+    CHECK(room == 0);
+    
+    // The idle shard only holds back what is newer than now - the delay
+    CHECK(merge.merge(out, now) == 4);
+    merge.reserve(0, room);
+    CHECK(room == 4);
+}
+
+static void testNumbersMatchStrtod() {
+    // Around the fast path's limits: 10^22 either way, 15 digit mantissas
+    // (the longest it takes) and the 16-19 digit ones it hands on, leading
+    // zeros on both sides of the point, signs and a bare exponent marker
+    const char* numbers[] = {
+        "1e22", "1e23", "1e-22", "1e-23", "-1e22", "+1e-22", "9e22", "123456789012345e22", "123456789012345e-22",
+        "123456789012345e23", "123456789012345e-23", "999999999999999", "9999999999999999", "1234567890123456",
+        "12345678901234567", "123456789012345678", "1234567890123456789", "12345678901234567890",
+        "9007199254740993", "0.123456789012345", "0.1234567890123456", "1.234567890123456789e-5",
+        "000000123.4500", "-0000.000001", "+0.00000000000000000000001234", "0.000000000000000000000000000001e30",
+        "100000000000000000000000e-24", "0.1", "0.2", "0.3", "-2.5", "+.5", "5.", "7e", "7e+", "-0", "-0.0",
+        "1.7976931348623157e308", "2.2250738585072014e-308", "4.9e-324", "3.14159265358979323846",
+        "1e0", "1E+2", "2e-0", "123.456e-3", "0.000123456789012345e10",
+        // 16-19 digits where converting the mantissa, then scaling, rounds
+        // twice and lands one ulp off
+        "9514242627359937e-16", "9768070884241057e9", "66688231833028549e15", "34932996677935535e1",
+        "296399253678720728e-12", "496404257899055657e14", "5234742737811811578e-5", "6177612447653265513e-9",
+    };
+    locale_t c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    DataParser parser;
+    for (const char* number : numbers) {
+        std::string text(number);
+        double expected = strtod_l(text.c_str(), nullptr, c_locale);
+        std::vector<double> parsed = parser.parseData(text);
+        bool same = parsed.size() == 1 && std::memcmp(&parsed[0], &expected, sizeof(expected)) == 0;
+        if (!same) {
+            std::cerr << "parsing " << number << " differs from strtod" << std::endl;
+        }
+        CHECK(same);
+    }
+    freelocale(c_locale);
+    
+    // Beyond double range or not numbers at all
+    const char* rejected[] = { "1e309", "-1e400", "inf", "nan", ".", "-", "e5", "1.2.3", "0x10" };
+    for (const char* text : rejected) {
+        CHECK(!parser.isValidNumber(text));
+    }
+}
+
+static void testWireHeaderRejectsUnknownFields() {
+    const long long now = 1700000000000000000LL;
+    const double values[] = { 1, 2 };
+    char datagram[64];
+    DataParser parser;
+    std::vector<Sample> samples;
+    
+    size_t length = encodeWireSamples(datagram, sizeof(datagram), values, 2, 0, false);
+    CHECK(parser.parseInto(datagram, length, samples, now) == 2);
+    
+    datagram[5] |= 0x10; // A flag this version does not know
+    CHECK(parser.parseInto(datagram, length, samples, now) == 0);
+    
+    length = encodeWireSamples(datagram, sizeof(datagram), values, 2, 0, false);
+    datagram[11] = 1; // Reserved
+    CHECK(parser.parseInto(datagram, length, samples, now) == 0);
+    CHECK(parser.getMalformedCount() == 2);
+}
+
+static void testWireIntervalOverADayIsRejected() {
+    const long long now = 1700000000000000000LL;
+    const double values[] = { 1, 2, 3 };
+    char datagram[256];
+    DataParser parser;
+    std::vector<Sample> samples;
+    
+    // (count - 1) * interval would overflow a long long
+    size_t length = encodeWireSamples(datagram, sizeof(datagram), values, 3, 0, true, -1, 4000000000000000000LL);
+    CHECK(parser.parseInto(datagram, length, samples, now) == 0);
+    CHECK(parser.getMalformedCount() == 1);
+    
+    length = encodeWireSamples(datagram, sizeof(datagram), values, 3, 0, true, -1, WIRE_MAX_INTERVAL_NS);
+    CHECK(parser.parseInto(datagram, length, samples, now) == 3);
+    CHECK(samples.back().timestamp_ns == now);
+    CHECK(samples.front().timestamp_ns == now - 2 * WIRE_MAX_INTERVAL_NS);
+}
+
+static void testFutureTimestampFallsBackToReceiveTime() {
+    const long long now = 1700000000000000000LL;
+    const long long year = 365 * 86400000000000LL;
+    const double values[] = { 1, 2 };
+    char datagram[256];
+    DataParser parser;
+    std::vector<Sample> samples;
+    
+    // A base a year ahead is ignored, and the values end at receive time
+    size_t length = encodeWireSamples(datagram, sizeof(datagram), values, 2, 0, true, now + year, 1000);
+    CHECK(parser.parseInto(datagram, length, samples, now) == 2);
+    CHECK(parser.getMalformedCount() == 1);
+    CHECK(samples.size() == 2 && samples[1].timestamp_ns == now && samples[0].timestamp_ns == now - 1000);
+    
+    // A plausible base whose interval carries the last value too far ahead
+    samples.clear();
+    length = encodeWireSamples(datagram, sizeof(datagram), values, 2, 0, true, now, DataParser::MAX_SENDER_LEAD_NS + 1);
+    parser.parseInto(datagram, length, samples, now);
+    CHECK(parser.getMalformedCount() == 2);
+    CHECK(samples.size() == 2 && samples[1].timestamp_ns == now);
+    
+    // Small clock skew is kept
+    samples.clear();
+    length = encodeWireSamples(datagram, sizeof(datagram), values, 2, 0, true, now + 1000, 1000);
+    parser.parseInto(datagram, length, samples, now);
+    CHECK(parser.getMalformedCount() == 2);
+    CHECK(samples.size() == 2 && samples[0].timestamp_ns == now + 1000);
+    
+    // The same for @t in text datagrams; 1700000000 s is now
+    const char* future = "@t=1800000000 @dt=0.5 1 2";
+    samples.clear();
+    CHECK(parser.parseInto(future, strlen(future), samples, now) == 2);
+    CHECK(parser.getMalformedCount() == 3);
+    CHECK(samples.size() == 2 && samples[1].timestamp_ns == now && samples[0].timestamp_ns == now - 500000000);
+    
+    const char* recent = "@t=1699999999 @dt=0.5 1 2";
+    samples.clear();
+    parser.parseInto(recent, strlen(recent), samples, now);
+    CHECK(parser.getMalformedCount() == 3);
+    CHECK(samples.size() == 2 && samples[0].timestamp_ns == now - 1000000000);
+    
+    // Out of range in ns altogether
+    const char* huge = "@t=99999999999 1";
+    samples.clear();
+    CHECK(parser.parseInto(huge, strlen(huge), samples, now) == 1);
+    CHECK(parser.getMalformedCount() == 4);
+    CHECK(samples.size() == 1 && samples[0].timestamp_ns == now);
+}
+
+static void testIntervalWithoutBaseStaysInLag() {
+    const long long now = 1700000000000000000LL;
+    std::vector<double> values(65535, 1.0);
+    std::vector<char> datagram(WIRE_HEADER_SIZE + WIRE_INTERVAL_SIZE + values.size() * 4);
+    DataParser parser;
+    std::vector<Sample> samples;
+    
+    // 65534 days back from the receive time would be ~180 years
+    size_t length = encodeWireSamples(&datagram[0], datagram.size(), &values[0], values.size(), 0, false, -1,
+                                      WIRE_MAX_INTERVAL_NS);
+    CHECK(parser.parseInto(&datagram[0], length, samples, now) == values.size());
+    CHECK(parser.getMalformedCount() == 1);
+    CHECK(samples.front().timestamp_ns == now && samples.back().timestamp_ns == now);
+    
+    // Same for text: 9 values a day apart reach back 8 days
+    const char* text = "@dt=86400 1 2 3 4 5 6 7 8 9";
+    samples.clear();
+    CHECK(parser.parseInto(text, strlen(text), samples, now) == 9);
+    CHECK(parser.getMalformedCount() == 2);
+    CHECK(samples.size() == 9 && samples[0].timestamp_ns == now);
+    
+    // A week's worth is still spread
+    const char* week = "@dt=86400 1 2 3 4 5 6 7 8";
+    samples.clear();
+    parser.parseInto(week, strlen(week), samples, now);
+    CHECK(parser.getMalformedCount() == 2);
+    CHECK(samples.size() == 8 && samples[0].timestamp_ns == now - DataParser::MAX_SENDER_LAG_NS);
+}
+
+static void testWideZoomReadsCoarsestTier() {
+    const long long minute = 60000000000LL;
+    const long long span = 48 * 60 * minute;
+    const int columns = 100;
+    
+    // A two-day window over 100 columns has 29 min columns, which the
+    // 10 min tier covers with three buckets each
+    int tier = RollupTiers::tierFor(span / columns);
+    CHECK(tier == RollupTiers::TIER_COUNT - 1);
+    CHECK(span / RollupTiers::TIER_NS[tier] <= (long long)RollupTiers::TIER_BUCKETS[tier]);
+    
+    RollupTiers rollups;
+    for (long long t = 0; t < span; t += minute) {
+        rollups.add(t, 1.0);
+    }
+    std::vector<ColumnSummary> summaries(columns);
+    for (ColumnSummary& summary : summaries) {
+        summary.reset();
+    }
+    rollups.summarize(0, span, span, summaries.data(), columns);
+    size_t total = 0;
+    for (const ColumnSummary& summary : summaries) {
+        total += summary.count;
+    }
+    CHECK(total == 48 * 60);
+}
+
+static void testWindowSketchGivesBackExpiredInterval() {
+    ValueSketch older, newer, window;
+    for (int i = 0; i < 1000; ++i) {
+        older.add(1000 + i);
+        newer.add(10 + i % 50);
+    }
+    window.merge(older);
+    window.merge(newer);
+    window.subtract(older, newer.getSum(), newer.getMin(), newer.getMax());
+    
+    CHECK(window.getCount() == newer.getCount());
+    CHECK(window.getMin() == 10 && window.getMax() == 59);
+    CHECK(window.quantile(0.5) == newer.quantile(0.5));
+    CHECK(window.quantile(0.999) == newer.quantile(0.999));
+    
+    // Values within a few octaves use a sliver of the 16385 buckets
+    CHECK(newer.getBytes() < 8192);
+    
+    window.subtract(newer, 0, 0, 0);
+    CHECK(window.getCount() == 0);
+    window.add(-1);
+    CHECK(window.quantile(0.5) == -1);
+}
+
+static void testShardLogsReplayInTimestampOrder() {
+    std::string path = "/tmp/udp_graph_core_test_" + std::to_string(getpid()) + ".log";
+    unlink(path.c_str());
+    
+    // Two shards' recorders flush whole buffers, each behind the other
+    {
+        TrafficRecorder first(path);
+        TrafficRecorder second(path);
+        Datagram datagram;
+        std::memset(&datagram, 0, sizeof(datagram));
+        datagram.data = "1";
+        datagram.length = 1;
+        const long long first_times[] = { 100, 300, 500 };
+        const long long second_times[] = { 50, 200, 400, 600 };
+        for (long long t : first_times) {
+            first.record(datagram, t);
+        }
+        for (long long t : second_times) {
+            second.record(datagram, t);
+        }
+        second.flush(); // 50..600 land before 100..500
+        first.flush();
+    }
+    
+    TrafficLog log(path);
+    CHECK(log.getRecordCount() == 7);
+    CHECK(log.getFirstTimestamp() == 50);
+    CHECK(log.getLastTimestamp() == 600);
+    
+    LoggedDatagram record;
+    long long previous = 0;
+    size_t count = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        log.rewind();
+        previous = 0;
+        count = 0;
+        while (log.next(record)) {
+            CHECK(record.timestamp_ns >= previous);
+            previous = record.timestamp_ns;
+            ++count;
+        }
+        CHECK(count == 7);
+    }
+    unlink(path.c_str());
+}
+
+static void testHistoryRoundTripsEveryEncoding() {
+    std::vector<long long> timestamps;
+    std::vector<double> values;
+    
+    // Delta-of-deltas on both sides of each bucket edge, up to the 32 bit
+    // escape, and one past it that has to start a new block
+    const long long dods[] = { 0, -63, 64, -64, 65, -255, 256, -256, 257, -2047, 2048, -2048, 2049,
+                               2147483647LL, -2147483647LL - 1, 0, 8589934592LL, 0 };
+    long long timestamp = 1700000000000LL;
+    long long delta = 10000;
+    timestamps.push_back(timestamp);
+    for (long long dod : dods) {
+        delta += dod;
+        timestamp += delta;
+        timestamps.push_back(timestamp);
+    }
+    
+    // Values: repeats (zero XOR), neighbours one ulp apart (more than 31
+    // leading zeros, clamped), a sign and low bit flip together (all 64
+    // bits meaningful), then noise
+    const double special[] = { 1.0, 1.0, std::nextafter(1.0, 2.0), 1.0, -std::nextafter(1.0, 2.0), 0.0, -0.0,
+                               1e300, -1e-300 };
+    for (size_t i = 0; i < timestamps.size(); ++i) {
+        values.push_back(special[i % (sizeof(special) / sizeof(special[0]))]);
+    }
+    
+    // Enough noisy samples to cross several blocks
+    std::srand(7);
+    for (int i = 0; i < 3000; ++i) {
+        timestamp += 1 + std::rand() % 20;
+        timestamps.push_back(timestamp);
+        values.push_back((std::rand() - RAND_MAX / 2) / 1e3);
+    }
+    
+    CompressedHistory history(1 << 30);
+    history.append(timestamps[0], values[0]);
+    size_t block_bytes = history.getBytes();
+    for (size_t i = 1; i < timestamps.size(); ++i) {
+        history.append(timestamps[i], values[i]);
+    }
+    CHECK(history.size() == timestamps.size());
+    CHECK(history.getBytes() >= 4 * block_bytes);
+    
+    size_t index = 0;
+    size_t mismatches = 0;
+    history.forEach([&](long long t, double v) {
+        if (index >= timestamps.size() || t != timestamps[index] ||
+            std::memcmp(&v, &values[index], sizeof(v)) != 0) {
+            ++mismatches;
+        }
+        ++index;
+    });
+    CHECK(index == timestamps.size());
+    CHECK(mismatches == 0);
+    
+    // The byte limit drops whole blocks from the front
+    history.setLimit(2 * block_bytes);
+    CHECK(history.getBytes() <= 2 * block_bytes);
+    CHECK(history.size() > 0 && history.size() < timestamps.size());
+}
+
+static void testSequenceGapsReordersDuplicatesAndRestarts() {
+    SequenceTracker tracker;
+    const uint64_t sender = 1;
+    
+    // Gap: 3 and 4 are missing, then 4 turns up late and 5 twice
+    const uint64_t arrivals[] = { 1, 2, 5, 4, 5, 6 };
+    for (uint64_t sequence : arrivals) {
+        tracker.record(sender, sequence);
+    }
+    LossCounts counts = tracker.getCounts();
+    CHECK(counts.sequenced == 6);
+    CHECK(counts.lost == 1);
+    CHECK(counts.reordered == 1);
+    CHECK(counts.duplicates == 1);
+    
+    // A jump far ahead is a restart, not 2^63 lost datagrams
+    tracker.record(sender, 1ULL << 63);
+    tracker.record(sender, (1ULL << 63) + 1);
+    CHECK(tracker.getCounts().lost == 1);
+    CHECK(tracker.getCounts().lossPercent() < 20);
+    
+    // So is a run starting over below the window but within
+    // RESTART_DISTANCE: one late-looking datagram, then continuing
+    uint64_t top = (1ULL << 63) + 500;
+    tracker.record(sender, top); // 498 more lost
+    counts = tracker.getCounts();
+    CHECK(counts.lost == 499);
+    for (uint64_t sequence = top - 300; sequence < top - 290; ++sequence) {
+        tracker.record(sender, sequence);
+    }
+    CHECK(tracker.getCounts().lost == 499);
+    CHECK(tracker.getCounts().reordered == 1);
+    tracker.record(sender, top - 290);
+    CHECK(tracker.getCounts().lost == 499); // No gap after the restart
+    
+    // A lone datagram from below the window is late, and gives back one lost
+    tracker.record(sender, top - 290 - 100);
+    tracker.record(sender, top - 289);
+    CHECK(tracker.getCounts().reordered == 2);
+    CHECK(tracker.getCounts().lost == 498);
+    
+    // A restart far below resets too
+    tracker.record(sender, 0);
+    tracker.record(sender, 1);
+    CHECK(tracker.getCounts().lost == 498);
+    CHECK(tracker.getCounts().reordered == 2);
+}
+
+int main() {
+    testShardsInterleaveAcrossDrains();
+    testIdleShardReleasesAfterDelay();
+    testLaggingShardDoesNotStallLiveOne();
+    testFullBufferKeepsMoving();
+    testNumbersMatchStrtod();
+    testWireHeaderRejectsUnknownFields();
+    testWireIntervalOverADayIsRejected();
+    testFutureTimestampFallsBackToReceiveTime();
+    testIntervalWithoutBaseStaysInLag();
+    testWideZoomReadsCoarsestTier();
+    testWindowSketchGivesBackExpiredInterval();
+    testShardLogsReplayInTimestampOrder();
+    testHistoryRoundTripsEveryEncoding();
+    testSequenceGapsReordersDuplicatesAndRestarts();
+    
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "traffic_log.h"
+#include "wire_format.h"
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const size_t TrafficRecorder::BUFFER_SIZE;
+
+namespace {
+    bool hasLogHeader(const char* data, size_t length) {
+        return length >= TRAFFIC_LOG_HEADER_SIZE &&
+               std::memcmp(data, TRAFFIC_LOG_MAGIC, sizeof(TRAFFIC_LOG_MAGIC)) == 0 &&
+               wireLoadLE(data + 4, 4) == TRAFFIC_LOG_VERSION;
+    }
+    
+    void writeAll(int fd, const char* data, size_t length) {
+        while (length > 0) {
+            ssize_t written = write(fd, data, length);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Failed to write traffic log: " + std::string(std::strerror(errno)));
+            }
+            data += written;
+            length -= written;
+        }
+    }
+}
+
+TrafficRecorder::TrafficRecorder(const std::string& path) : fd(-1), buffer(BUFFER_SIZE), used(0) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644); // Read for the header check
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to stat " + path + ": " + std::strerror(errno));
+    }
+    
+    if (info.st_size == 0) {
+        char header[TRAFFIC_LOG_HEADER_SIZE];
+        std::memcpy(header, TRAFFIC_LOG_MAGIC, sizeof(TRAFFIC_LOG_MAGIC));
+        wireStoreLE(header + 4, TRAFFIC_LOG_VERSION, 4);
+        writeAll(fd, header, sizeof(header));
+    } else {
+        // Refuse to append records to something that is not a log
+        char header[TRAFFIC_LOG_HEADER_SIZE];
+        if (pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+            !hasLogHeader(header, sizeof(header))) {
+            close(fd);
+            throw std::runtime_error(path + " exists and is not a traffic log");
+        }
+    }
+}
+
+TrafficRecorder::~TrafficRecorder() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Nothing left to report to
+    }
+    close(fd);
+}
+
+void TrafficRecorder::record(const Datagram& datagram, long long timestamp_ns) {
+    size_t record_size = TRAFFIC_RECORD_HEADER_SIZE + datagram.length;
+    if (used + record_size > buffer.size()) {
+        flush();
+    }
+    
+    char* p = &buffer[used];
+    wireStoreLE(p, (uint64_t)timestamp_ns, 8);
+    std::memcpy(p + 8, &datagram.sender.sin_addr.s_addr, 4);
+    std::memcpy(p + 12, &datagram.sender.sin_port, 2);
+    wireStoreLE(p + 14, datagram.length, 2);
+    std::memcpy(p + TRAFFIC_RECORD_HEADER_SIZE, datagram.data, datagram.length);
+    used += record_size;
+}
+
+void TrafficRecorder::flush() {
+    if (used == 0) {
+        return;
+    }
+    size_t length = used;
+    used = 0;
+    writeAll(fd, &buffer[0], length);
+}
+
+TrafficLog::TrafficLog(const std::string& path)
+    : fd(-1), base(nullptr), size(0), offset(TRAFFIC_LOG_HEADER_SIZE), cursor(0), record_count(0),
+      first_timestamp(0), last_timestamp(0) {
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < (off_t)TRAFFIC_LOG_HEADER_SIZE) {
+        close(fd);
+        throw std::runtime_error(path + " is not a traffic log");
+    }
+    size = info.st_size;
+    
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map " + path + ": " + std::strerror(errno));
+    }
+    base = static_cast<const char*>(mapped);
+    if (!hasLogHeader(base, size)) {
+        munmap(mapped, size);
+        close(fd);
+        throw std::runtime_error(path + " is not a traffic log");
+    }
+    
+    // One pass over the record headers for the count and time span, noting
+    // the offsets in case several recorders left the file out of order
+    LoggedDatagram record;
+    size_t position = TRAFFIC_LOG_HEADER_SIZE;
+    size_t record_position = position;
+    bool in_order = true;
+    while (readAt(record_position, record, position)) {
+        if (record_count == 0) {
+            first_timestamp = last_timestamp = record.timestamp_ns;
+        }
+        in_order = in_order && record.timestamp_ns >= last_timestamp;
+        first_timestamp = std::min(first_timestamp, record.timestamp_ns);
+        last_timestamp = std::max(last_timestamp, record.timestamp_ns);
+        order.push_back(record_position);
+        ++record_count;
+        record_position = position;
+    }
+    
+    // Each recorder's records are in order, so a stable sort keeps ties in
+    // the order they were received
+    if (in_order) {
+        std::vector<size_t>().swap(order);
+        madvise(mapped, size, MADV_SEQUENTIAL);
+    } else {
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return timestampAt(a) < timestampAt(b);
+        });
+    }
+}
+
+TrafficLog::~TrafficLog() {
+    munmap(const_cast<char*>(base), size);
+    close(fd);
+}
+
+bool TrafficLog::readAt(size_t position, LoggedDatagram& out, size_t& next_position) const {
+    if (size - position < TRAFFIC_RECORD_HEADER_SIZE) {
+        return false;
+    }
+    const char* p = base + position;
+    size_t length = wireLoadLE(p + 14, 2);
+    if (size - position - TRAFFIC_RECORD_HEADER_SIZE < length) {
+        return false;
+    }
+    
+    out.timestamp_ns = timestampAt(position);
+    std::memset(&out.sender, 0, sizeof(out.sender));
+    out.sender.sin_family = AF_INET;
+    std::memcpy(&out.sender.sin_addr.s_addr, p + 8, 4);
+    std::memcpy(&out.sender.sin_port, p + 12, 2);
+    out.data = p + TRAFFIC_RECORD_HEADER_SIZE;
+    out.length = length;
+    next_position = position + TRAFFIC_RECORD_HEADER_SIZE + length;
+    return true;
+}
+
+long long TrafficLog::timestampAt(size_t position) const {
+    return (long long)wireLoadLE(base + position, 8);
+}
+
+bool TrafficLog::next(LoggedDatagram& out) {
+    if (order.empty()) {
+        return readAt(offset, out, offset);
+    }
+    size_t unused;
+    return cursor < order.size() && readAt(order[cursor++], out, unused);
+}
@@ -0,0 +1,100 @@
+#ifndef TRAFFIC_LOG_H
+#define TRAFFIC_LOG_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <netinet/in.h>
+#include "udp_listener.h"
+
+// Append-only log of received datagrams, written by --record and read back
+// by --replay.
+//
+// Layout (all fields little-endian unless noted):
+//   file header
+//        0     4  magic      'U' 'G' 'R' 'L'
+//        4     4  version    TRAFFIC_LOG_VERSION
+//   then one record per datagram
+//        0     8  timestamp  receive time in ns since the epoch
+//        8     4  address    sender IPv4 address (network byte order)
+//       12     2  port       sender port (network byte order)
+//       14     2  length     payload length
+//       16     .  payload
+//
+// Several recorders may append to the same file: each flush is a single
+// O_APPEND write of whole records, so records never interleave. The file
+// is then only in order per recorder (with -j N, one per receive shard);
+// TrafficLog puts the records back in timestamp order when reading.
+
+const unsigned char TRAFFIC_LOG_MAGIC[4] = { 'U', 'G', 'R', 'L' };
+const uint32_t TRAFFIC_LOG_VERSION = 1;
+const size_t TRAFFIC_LOG_HEADER_SIZE = 8;
+const size_t TRAFFIC_RECORD_HEADER_SIZE = 16;
+
+// Buffers records in memory and appends them to the log in large writes,
+// so recording adds a memcpy per datagram to the receive path
+class TrafficRecorder {
+private:
+    int fd;
+    std::vector<char> buffer;
+    size_t used;
+    
+public:
+    static const size_t BUFFER_SIZE = 1 << 20;
+    
+    // Open or create the log at path; an existing file must be a traffic log
+    explicit TrafficRecorder(const std::string& path);
+    ~TrafficRecorder(); // Flushes
+    
+    void record(const Datagram& datagram, long long timestamp_ns);
+    
+    // Write out buffered records; throws std::runtime_error on failure
+    void flush();
+    bool hasPending() const { return used > 0; }
+};
+
+// A record read back from the log. data points into the mapped file.
+struct LoggedDatagram {
+    long long timestamp_ns;
+    struct sockaddr_in sender;
+    const char* data;
+    size_t length;
+};
+
+// Read-only view of a log through mmap, iterated in timestamp order
+class TrafficLog {
+private:
+    int fd;
+    const char* base;
+    size_t size;
+    size_t offset; // Next record when the file is in order
+    std::vector<size_t> order; // Record offsets by timestamp, empty if the file is in order
+    size_t cursor; // Next entry of order
+    size_t record_count;
+    long long first_timestamp;
+    long long last_timestamp;
+    
+    bool readAt(size_t position, LoggedDatagram& out, size_t& next_position) const;
+    long long timestampAt(size_t position) const;
+    
+public:
+    // Map the log at path; throws std::runtime_error if it is not a traffic log
+    explicit TrafficLog(const std::string& path);
+    ~TrafficLog();
+    
+    // Next record, or false at the end. A truncated final record (from a
+    // recorder that was killed mid-write) is treated as the end of its file.
+    bool next(LoggedDatagram& out);
+    void rewind() {
+        offset = TRAFFIC_LOG_HEADER_SIZE;
+        cursor = 0;
+    }
+    
+    size_t getRecordCount() const { return record_count; }
+    
+    // Earliest and latest timestamps in the log, whatever the file order
+    long long getFirstTimestamp() const { return first_timestamp; }
+    long long getLastTimestamp() const { return last_timestamp; }
+};
+
+#endif // TRAFFIC_LOG_H
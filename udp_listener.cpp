@@ -3,10 +3,28 @@
 #include <cstring>
 #include <unistd.h>
 #include <sys/select.h>
+#include <time.h>
 #include <stdexcept>
 #include <errno.h>
+#include <algorithm>
+#include <netinet/udp.h>
 
-UDPListener::UDPListener(int port) : is_running(false) {
+const size_t UDPListener::DATAGRAM_BUFFER_SIZE;
+const size_t UDPListener::DEFAULT_BATCH_SIZE;
+
+namespace {
+    // Room for an SCM_TIMESTAMPNS, an SO_RXQ_OVFL and a UDP_GRO message per datagram
+    const size_t CONTROL_SIZE = CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t)) +
+                                CMSG_SPACE(sizeof(int));
+}
+
+UDPListener::UDPListener(int port, size_t batch, bool reuse_port, int buffer_bytes, bool use_gro)
+    : is_running(false), batch_size(batch), receive_buffer(0), last_overflow(0), kernel_drops(0),
+      truncated_count(0), gro(false) {
+    if (batch_size == 0) {
+        batch_size = 1;
+    }
+    
     // Create UDP socket
     sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0) {
@@ -20,6 +38,34 @@ UDPListener::UDPListener(int port) : is_running(false) {
         throw std::runtime_error("Failed to set socket options: " + std::string(strerror(errno)));
     }
     
+    if (reuse_port && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        close(sockfd);
+        throw std::runtime_error("Failed to enable SO_REUSEPORT: " + std::string(strerror(errno)));
+    }
+    
+    // Ask the kernel to stamp each datagram on arrival, so timestamps do not
+    // include queueing in the socket buffer or our own processing. Without
+    // it datagrams fall back to the time they were read.
+    setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt));
+    
+    // Have every datagram carry the socket's running drop counter
+    setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &opt, sizeof(opt));
+    
+    // SO_RCVBUFFORCE ignores net.core.rmem_max but needs CAP_NET_ADMIN.
+    // The kernel doubles the value for its bookkeeping and reports that.
+    if (buffer_bytes > 0 && setsockopt(sockfd, SOL_SOCKET, SO_RCVBUFFORCE, &buffer_bytes, sizeof(buffer_bytes)) < 0) {
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &buffer_bytes, sizeof(buffer_bytes));
+    }
+    
+    // Older kernels lack UDP_GRO; datagrams then just arrive one by one
+    gro = use_gro && setsockopt(sockfd, SOL_UDP, UDP_GRO, &opt, sizeof(opt)) == 0;
+    
+    int granted = 0;
+    socklen_t granted_length = sizeof(granted);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &granted_length) == 0) {
+        receive_buffer = granted / 2;
+    }
+    
     // Configure server address
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
@@ -32,6 +78,23 @@ UDPListener::UDPListener(int port) : is_running(false) {
         throw std::runtime_error("Failed to bind socket to port " + std::to_string(port) + ": " + std::string(strerror(errno)));
     }
     
+    // Preallocate the receive buffers and message headers used by receiveBatch()
+    buffers.reset(new char[batch_size * DATAGRAM_BUFFER_SIZE]);
+    messages.resize(batch_size);
+    iovecs.resize(batch_size);
+    senders.resize(batch_size);
+    controls.resize(batch_size * CONTROL_SIZE);
+    for (size_t i = 0; i < batch_size; ++i) {
+        iovecs[i].iov_base = &buffers[i * DATAGRAM_BUFFER_SIZE];
+        iovecs[i].iov_len = DATAGRAM_BUFFER_SIZE; // Payloads are used by length, not null-terminated
+        
+        memset(&messages[i], 0, sizeof(messages[i]));
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &senders[i];
+        messages[i].msg_hdr.msg_control = &controls[i * CONTROL_SIZE];
+    }
+    
     is_running = true;
 }
 
@@ -41,11 +104,7 @@ UDPListener::~UDPListener() {
     }
 }
 
-std::string UDPListener::receiveData(int timeout_ms) {
-    if (!is_running) {
-        return "";
-    }
-    
+bool UDPListener::waitReadable(int timeout_ms) {
     fd_set readfds;
     struct timeval timeout;
     
@@ -62,34 +121,123 @@ std::string UDPListener::receiveData(int timeout_ms) {
         if (errno != EINTR) {
             throw std::runtime_error("Select error: " + std::string(strerror(errno)));
         }
+        return false;
+    }
+    
+    // activity == 0 means the timeout occurred
+    return activity > 0 && FD_ISSET(sockfd, &readfds);
+}
+
+std::string UDPListener::receiveData(int timeout_ms) {
+    if (!is_running || !waitReadable(timeout_ms)) {
         return "";
     }
     
-    if (activity == 0) {
-        // Timeout occurred
+    std::vector<char> buffer(DATAGRAM_BUFFER_SIZE);
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    
+    // MSG_TRUNC makes recvfrom() return the full datagram length
+    ssize_t bytes_received = recvfrom(sockfd, &buffer[0], buffer.size(), MSG_TRUNC,
+                                     (struct sockaddr*)&client_addr, &client_len);
+    
+    if (bytes_received < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            throw std::runtime_error("Receive error: " + std::string(strerror(errno)));
+        }
+        return "";
+    }
+    if ((size_t)bytes_received > buffer.size()) {
+        ++truncated_count;
         return "";
     }
     
-    if (FD_ISSET(sockfd, &readfds)) {
-        char buffer[1024];
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
+    return std::string(&buffer[0], bytes_received);
+}
+
+size_t UDPListener::receiveBatch(std::vector<Datagram>& out, int timeout_ms) {
+    out.clear();
+    if (!is_running || !waitReadable(timeout_ms)) {
+        return 0;
+    }
+    return receiveReady(out);
+}
+
+size_t UDPListener::receiveReady(std::vector<Datagram>& out) {
+    out.clear();
+    out.reserve(batch_size);
+    if (!is_running) {
+        return 0;
+    }
+    
+    // The name and control lengths are in/out fields, so they have to be reset before every call
+    for (size_t i = 0; i < batch_size; ++i) {
+        messages[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+        messages[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+    }
+    
+    // Take whatever is queued without blocking
+    int count = recvmmsg(sockfd, messages.data(), batch_size, MSG_DONTWAIT, nullptr);
+    
+    if (count < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            throw std::runtime_error("Receive error: " + std::string(strerror(errno)));
+        }
+        return 0;
+    }
+    
+    for (int i = 0; i < count; ++i) {
+        char* buffer = &buffers[i * DATAGRAM_BUFFER_SIZE];
+        size_t length = messages[i].msg_len;
+        if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            ++truncated_count; // The tail is gone, and a cut number would be misread
+            continue;
+        }
         
-        ssize_t bytes_received = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 0,
-                                         (struct sockaddr*)&client_addr, &client_len);
+        Datagram datagram;
+        datagram.data = buffer;
+        datagram.length = length;
+        datagram.sender = senders[i];
+        datagram.timestamp_ns = 0;
         
-        if (bytes_received < 0) {
-            if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                throw std::runtime_error("Receive error: " + std::string(strerror(errno)));
+        size_t segment_size = 0;
+        struct msghdr& header = messages[i].msg_hdr;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec stamp;
+                memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+                datagram.timestamp_ns = stamp.tv_sec * 1000000000LL + stamp.tv_nsec;
+            } else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                // A 32 bit running total; only the difference matters
+                uint32_t overflow;
+                memcpy(&overflow, CMSG_DATA(cmsg), sizeof(overflow));
+                kernel_drops += (uint32_t)(overflow - last_overflow);
+                last_overflow = overflow;
+            } else if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int gso_size;
+                memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+                segment_size = gso_size > 0 ? (size_t)gso_size : 0;
             }
-            return "";
         }
         
-        buffer[bytes_received] = '\0';
-        return std::string(buffer);
+        // A GRO train is the sender's datagrams back to back, all of
+        // segment_size bytes except possibly the last
+        if (segment_size == 0 || segment_size >= length) {
+            out.push_back(datagram);
+            continue;
+        }
+        for (size_t offset = 0; offset < length; offset += segment_size) {
+            datagram.data = buffer + offset;
+            datagram.length = std::min(segment_size, length - offset);
+            out.push_back(datagram);
+        }
     }
     
-    return "";
+    // A full batch of oversized datagrams: the socket may still hold more
+    if (out.empty() && (size_t)count == batch_size) {
+        return receiveReady(out);
+    }
+    return out.size();
 }
 
 void UDPListener::stop() {
@@ -2,22 +2,85 @@
 #define UDP_LISTENER_H
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 
+// A single datagram received by receiveBatch(). The payload points into the
+// listener's preallocated buffers and stays valid until the next receive call.
+// It is not null terminated: with UDP_GRO the next datagram may follow it.
+struct Datagram {
+    const char* data;
+    size_t length;
+    struct sockaddr_in sender;
+    long long timestamp_ns; // Kernel receive time (SO_TIMESTAMPNS), 0 if unavailable
+};
+
 class UDPListener {
 private:
     int sockfd;
     struct sockaddr_in server_addr;
     bool is_running;
-    
+
+    // Preallocated storage for recvmmsg()
+    size_t batch_size;
+    std::unique_ptr<char[]> buffers; // Left uninitialized so untouched pages stay unmapped
+    std::vector<struct mmsghdr> messages;
+    std::vector<struct iovec> iovecs;
+    std::vector<struct sockaddr_in> senders;
+    std::vector<char> controls; // Ancillary data carrying the receive timestamps and drop counter
+    int receive_buffer; // Effective SO_RCVBUF payload size
+    uint32_t last_overflow; // Last SO_RXQ_OVFL value seen
+    unsigned long long kernel_drops;
+    unsigned long long truncated_count;
+    bool gro; // UDP_GRO is on: one buffer may hold several datagrams
+
+    bool waitReadable(int timeout_ms);
+
 public:
-    UDPListener(int port);
+    static const size_t DATAGRAM_BUFFER_SIZE = 65536; // The largest UDP payload, or a GRO train
+    static const size_t DEFAULT_BATCH_SIZE = 64;
+
+    // With reuse_port several listeners can bind the same port and the
+    // kernel spreads senders across them (SO_REUSEPORT). A positive
+    // buffer_bytes asks for that much socket receive buffer; the kernel may
+    // grant less, see getReceiveBuffer(). With use_gro the kernel may
+    // coalesce a sender's datagrams into one receive (UDP_GRO), which is
+    // split again here; see isGroEnabled().
+    UDPListener(int port, size_t batch = DEFAULT_BATCH_SIZE, bool reuse_port = false, int buffer_bytes = 0,
+                bool use_gro = false);
     ~UDPListener();
-    
+
     std::string receiveData(int timeout_ms = 0);
+
+    // Drain up to batch_size datagrams with a single recvmmsg() call.
+    // Waits up to timeout_ms for the first datagram (0 = wait forever).
+    // Returns the number of datagrams stored in out.
+    size_t receiveBatch(std::vector<Datagram>& out, int timeout_ms = 0);
+    
+    // Like receiveBatch() but never waits: returns 0 once the socket is
+    // drained, for use with an edge-triggered poller on getFd()
+    size_t receiveReady(std::vector<Datagram>& out);
+
     void stop();
     bool isRunning() const { return is_running; }
+    int getFd() const { return sockfd; }
+    size_t getBatchSize() const { return batch_size; }
+    
+    // Receive buffer the socket ended up with, in payload bytes
+    int getReceiveBuffer() const { return receive_buffer; }
+    
+    // Datagrams the kernel dropped because the receive buffer was full, as
+    // of the last datagram received (SO_RXQ_OVFL)
+    unsigned long long getKernelDrops() const { return kernel_drops; }
+    
+    // Datagrams discarded because they did not fit the receive buffer
+    unsigned long long getTruncatedCount() const { return truncated_count; }
+    
+    // UDP_GRO was requested and the kernel supports it
+    bool isGroEnabled() const { return gro; }
 };
 
 #endif // UDP_LISTENER_H
@@ -0,0 +1,165 @@
+#include "value_sketch.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+const int ValueSketch::SUB_BUCKET_BITS;
+const int ValueSketch::MIN_EXPONENT;
+const int ValueSketch::MAX_EXPONENT;
+
+ValueSketch::ValueSketch() : base(0), lowest(BUCKETS), highest(-1) {
+    reset();
+}
+
+int ValueSketch::bucketOf(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    
+    int exponent = (int)((bits >> 52) & 0x7ff) - 1023;
+    if (exponent < MIN_EXPONENT) {
+        return ZERO_BUCKET;
+    }
+    
+    int magnitude = MAGNITUDE_BUCKETS - 1;
+    if (exponent < MAX_EXPONENT) {
+        int sub_bucket = (int)(bits >> (52 - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+        magnitude = ((exponent - MIN_EXPONENT) << SUB_BUCKET_BITS) | sub_bucket;
+    }
+    return (bits >> 63) ? ZERO_BUCKET - 1 - magnitude : ZERO_BUCKET + 1 + magnitude;
+}
+
+double ValueSketch::bucketMiddle(int bucket) {
+    if (bucket == ZERO_BUCKET) {
+        return 0;
+    }
+    int magnitude = bucket > ZERO_BUCKET ? bucket - ZERO_BUCKET - 1 : ZERO_BUCKET - 1 - bucket;
+    int exponent = (magnitude >> SUB_BUCKET_BITS) + MIN_EXPONENT;
+    int sub_bucket = magnitude & ((1 << SUB_BUCKET_BITS) - 1);
+    double middle = std::ldexp(1.0 + (sub_bucket + 0.5) / (1 << SUB_BUCKET_BITS), exponent);
+    return bucket > ZERO_BUCKET ? middle : -middle;
+}
+
+void ValueSketch::widen(int from, int to) {
+    int end = base + (int)counts.size();
+    if (!counts.empty() && from >= base && to < end) {
+        return;
+    }
+    
+    // Grow by at least half again, so values that creep outwards one
+    // bucket at a time do not copy the counts every time
+    int slack = std::max(16, (int)counts.size() / 2);
+    int new_base = counts.empty() ? from : std::min(base, from);
+    int new_end = counts.empty() ? to + 1 : std::max(end, to + 1);
+    if (!counts.empty() && new_base < base) {
+        new_base = std::max(0, new_base - slack);
+    }
+    if (counts.empty() || new_end > end) {
+        new_end = std::min(BUCKETS, new_end + slack);
+    }
+    
+    std::vector<uint64_t> grown(new_end - new_base, 0);
+    for (int i = lowest; i <= highest; ++i) {
+        grown[i - new_base] = counts[i - base];
+    }
+    counts.swap(grown);
+    base = new_base;
+}
+
+void ValueSketch::trim() {
+    while (lowest <= highest && counts[lowest - base] == 0) {
+        ++lowest;
+    }
+    while (highest >= lowest && counts[highest - base] == 0) {
+        --highest;
+    }
+    if (lowest > highest) {
+        lowest = BUCKETS;
+        highest = -1;
+    }
+}
+
+void ValueSketch::add(double value) {
+    if (std::isnan(value)) {
+        return;
+    }
+    
+    int bucket = bucketOf(value);
+    if (bucket < base || bucket >= base + (int)counts.size()) {
+        widen(bucket, bucket);
+    }
+    ++counts[bucket - base];
+    lowest = std::min(lowest, bucket);
+    highest = std::max(highest, bucket);
+    ++count;
+    sum += value;
+    min_value = std::min(min_value, value);
+    max_value = std::max(max_value, value);
+}
+
+void ValueSketch::merge(const ValueSketch& other) {
+    if (other.count == 0) {
+        return;
+    }
+    widen(other.lowest, other.highest);
+    
+    for (int i = other.lowest; i <= other.highest; ++i) {
+        counts[i - base] += other.counts[i - other.base];
+    }
+    lowest = std::min(lowest, other.lowest);
+    highest = std::max(highest, other.highest);
+    count += other.count;
+    sum += other.sum;
+    min_value = std::min(min_value, other.min_value);
+    max_value = std::max(max_value, other.max_value);
+}
+
+void ValueSketch::subtract(const ValueSketch& other, double remaining_sum, double remaining_min,
+                           double remaining_max) {
+    if (other.count == 0) {
+        return;
+    }
+    for (int i = other.lowest; i <= other.highest; ++i) {
+        counts[i - base] -= other.counts[i - other.base];
+    }
+    count -= other.count;
+    if (count == 0) {
+        reset();
+        return;
+    }
+    trim();
+    sum = remaining_sum;
+    min_value = remaining_min;
+    max_value = remaining_max;
+}
+
+void ValueSketch::reset() {
+    // Only the occupied range can be non-zero
+    for (int i = lowest; i <= highest; ++i) {
+        counts[i - base] = 0;
+    }
+    lowest = BUCKETS;
+    highest = -1;
+    count = 0;
+    sum = 0;
+    min_value = std::numeric_limits<double>::infinity();
+    max_value = -std::numeric_limits<double>::infinity();
+}
+
+double ValueSketch::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * (count - 1)) + 1;
+    if (rank >= count) {
+        return max_value;
+    }
+    uint64_t seen = 0;
+    for (int i = lowest; i <= highest; ++i) {
+        seen += counts[i - base];
+        if (seen >= rank) {
+            return std::min(max_value, std::max(min_value, bucketMiddle(i)));
+        }
+    }
+    return max_value;
+}
@@ -0,0 +1,78 @@
+#ifndef VALUE_SKETCH_H
+#define VALUE_SKETCH_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+// Constant-memory quantile sketch for arbitrary doubles, HDR histogram
+// style: buckets are picked straight from the IEEE-754 bits (exponent plus
+// the top SUB_BUCKET_BITS of the mantissa), so adding a value is a few
+// shifts and an increment, and quantiles are within 0.4% of the true value.
+// Sketches merge by adding counts, and a sketch merged into another can be
+// subtracted again, which is how rolling windows are kept.
+//
+// Only the span of buckets that have been used is stored, so a sketch of
+// values within a few octaves takes a few KiB rather than the 128 KiB of
+// every bucket.
+//
+// Magnitudes below 2^MIN_EXPONENT count as zero and those at or above
+// 2^MAX_EXPONENT share the top bucket; min and max stay exact regardless.
+class ValueSketch {
+public:
+    static const int SUB_BUCKET_BITS = 7;
+    static const int MIN_EXPONENT = -32;
+    static const int MAX_EXPONENT = 32;
+
+private:
+    // Buckets per sign, ordered by magnitude
+    static const int MAGNITUDE_BUCKETS = (MAX_EXPONENT - MIN_EXPONENT) << SUB_BUCKET_BITS;
+    // Negative values (largest magnitude first), zero, then positive values
+    static const int ZERO_BUCKET = MAGNITUDE_BUCKETS;
+    static const int BUCKETS = 2 * MAGNITUDE_BUCKETS + 1;
+    
+    std::vector<uint64_t> counts; // counts[i] is bucket base + i; grown on demand
+    int base;
+    int lowest;  // Occupied bucket range, so merges and queries skip the rest
+    int highest;
+    uint64_t count;
+    double sum;
+    double min_value;
+    double max_value;
+    
+    static int bucketOf(double value);
+    static double bucketMiddle(int bucket);
+    
+    // Make room for buckets [from, to], with slack so widening is amortized
+    void widen(int from, int to);
+    // Shrink [lowest, highest] past buckets that have emptied
+    void trim();
+
+public:
+    ValueSketch();
+    
+    void add(double value);
+    void merge(const ValueSketch& other);
+    
+    // Take out the values of other, which must have been merged in before.
+    // Bucket counts come out exactly; the sum, min and max cannot be taken
+    // apart, so the caller passes those of the values that remain.
+    void subtract(const ValueSketch& other, double remaining_sum, double remaining_min, double remaining_max);
+    
+    // Empty the sketch, keeping its storage for reuse
+    void reset();
+    
+    // Approximate value at quantile q (0-1), clamped to [min, max]
+    double quantile(double q) const;
+    
+    uint64_t getCount() const { return count; }
+    double getMin() const { return min_value; }
+    double getMax() const { return max_value; }
+    double getMean() const { return count > 0 ? sum / count : 0; }
+    double getSum() const { return sum; }
+    
+    // Memory held by the bucket counts
+    size_t getBytes() const { return counts.capacity() * sizeof(uint64_t); }
+};
+
+#endif // VALUE_SKETCH_H
@@ -0,0 +1,216 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+// Compact binary datagram format, accepted alongside the text protocol.
+//
+// Layout (all fields little-endian):
+//   offset  size  field
+//        0     4  magic      0x9E 'U' 'G' 'B' (cannot start a text datagram)
+//        4     1  version    WIRE_VERSION
+//        5     1  flags      WIRE_FLAG_* bits, others must be zero
+//        6     2  channel    sender-defined channel number
+//        8     2  count      number of samples that follow
+//       10     2  reserved   must be zero
+//       12     8  timestamp  base timestamp in ns since the epoch, only
+//                            present with WIRE_FLAG_TIMESTAMP
+//        .     8  interval   ns between consecutive samples, only present
+//                            with WIRE_FLAG_INTERVAL
+//        .     8  sequence   sender's datagram counter, only present with
+//                            WIRE_FLAG_SEQUENCE (see sequence_tracker.h)
+//        .     .  samples    count packed float32, or float64 with
+//                            WIRE_FLAG_FLOAT64
+//
+// Sample i is taken at timestamp + i * interval. Without a timestamp the
+// last sample is taken at the receive time and earlier ones are spaced
+// back from it by the interval. Intervals above WIRE_MAX_INTERVAL_NS are
+// rejected.
+//
+// A 1400 byte datagram carries 173 float64 or 347 float32 samples.
+//
+// This header is self-contained so senders can copy it as-is and use
+// encodeWireSamples() to build datagrams.
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+
+const unsigned char WIRE_MAGIC[4] = { 0x9E, 'U', 'G', 'B' };
+const uint8_t WIRE_VERSION = 1;
+
+const uint8_t WIRE_FLAG_FLOAT64 = 0x01;   // Samples are float64 instead of float32
+const uint8_t WIRE_FLAG_TIMESTAMP = 0x02; // Header carries a base timestamp
+const uint8_t WIRE_FLAG_INTERVAL = 0x04;  // Header carries the sample interval
+const uint8_t WIRE_FLAG_SEQUENCE = 0x08;  // Header carries a datagram sequence number
+const uint8_t WIRE_FLAGS_KNOWN = WIRE_FLAG_FLOAT64 | WIRE_FLAG_TIMESTAMP | WIRE_FLAG_INTERVAL | WIRE_FLAG_SEQUENCE;
+
+const size_t WIRE_HEADER_SIZE = 12;
+const size_t WIRE_TIMESTAMP_SIZE = 8;
+const size_t WIRE_INTERVAL_SIZE = 8;
+const size_t WIRE_SEQUENCE_SIZE = 8;
+
+// Longest accepted interval, one day as for the text @dt directive; keeps
+// count * interval well inside a long long
+const long long WIRE_MAX_INTERVAL_NS = 86400LL * 1000000000LL;
+
+struct WireHeader {
+    uint8_t version;
+    uint8_t flags;
+    uint16_t channel;
+    uint16_t count;
+    long long timestamp_ns; // Only meaningful with WIRE_FLAG_TIMESTAMP
+    long long interval_ns;  // Only meaningful with WIRE_FLAG_INTERVAL
+    uint64_t sequence;      // Only meaningful with WIRE_FLAG_SEQUENCE
+    size_t payload_offset;  // Where the samples start
+    size_t sample_size;     // 4 or 8 bytes
+};
+
+// Little-endian helpers; memcpy keeps unaligned access well defined
+inline uint64_t wireLoadLE(const char* p, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value |= (uint64_t)(unsigned char)p[i] << (8 * i);
+    }
+    return value;
+}
+
+inline void wireStoreLE(char* p, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        p[i] = (char)(value >> (8 * i));
+    }
+}
+
+inline bool isWireDatagram(const char* data, size_t length) {
+    return length >= sizeof(WIRE_MAGIC) && memcmp(data, WIRE_MAGIC, sizeof(WIRE_MAGIC)) == 0;
+}
+
+// Validate the header and check the payload fits in the datagram. Unknown
+// flags and a non-zero reserved field are rejected, so a later sender's
+// extensions are refused rather than misread.
+inline bool decodeWireHeader(const char* data, size_t length, WireHeader& header) {
+    if (length < WIRE_HEADER_SIZE || !isWireDatagram(data, length)) {
+        return false;
+    }
+    
+    header.version = (uint8_t)data[4];
+    header.flags = (uint8_t)data[5];
+    header.channel = (uint16_t)wireLoadLE(data + 6, 2);
+    header.count = (uint16_t)wireLoadLE(data + 8, 2);
+    header.timestamp_ns = 0;
+    header.interval_ns = 0;
+    header.sequence = 0;
+    header.payload_offset = WIRE_HEADER_SIZE;
+    header.sample_size = (header.flags & WIRE_FLAG_FLOAT64) ? 8 : 4;
+    
+    if (header.version != WIRE_VERSION || (header.flags & ~WIRE_FLAGS_KNOWN) != 0 || wireLoadLE(data + 10, 2) != 0) {
+        return false;
+    }
+    
+    if (header.flags & WIRE_FLAG_TIMESTAMP) {
+        if (length < header.payload_offset + WIRE_TIMESTAMP_SIZE) {
+            return false;
+        }
+        header.timestamp_ns = (long long)wireLoadLE(data + header.payload_offset, WIRE_TIMESTAMP_SIZE);
+        header.payload_offset += WIRE_TIMESTAMP_SIZE;
+    }
+    
+    if (header.flags & WIRE_FLAG_INTERVAL) {
+        if (length < header.payload_offset + WIRE_INTERVAL_SIZE) {
+            return false;
+        }
+        header.interval_ns = (long long)wireLoadLE(data + header.payload_offset, WIRE_INTERVAL_SIZE);
+        header.payload_offset += WIRE_INTERVAL_SIZE;
+        if (header.interval_ns < 0 || header.interval_ns > WIRE_MAX_INTERVAL_NS) {
+            return false;
+        }
+    }
+    
+    if (header.flags & WIRE_FLAG_SEQUENCE) {
+        if (length < header.payload_offset + WIRE_SEQUENCE_SIZE) {
+            return false;
+        }
+        header.sequence = wireLoadLE(data + header.payload_offset, WIRE_SEQUENCE_SIZE);
+        header.payload_offset += WIRE_SEQUENCE_SIZE;
+    }
+    
+    return header.payload_offset + (size_t)header.count * header.sample_size <= length;
+}
+
+// Read sample i of a datagram whose header was accepted by decodeWireHeader()
+inline double decodeWireSample(const char* data, const WireHeader& header, size_t i) {
+    const char* p = data + header.payload_offset + i * header.sample_size;
+    if (header.sample_size == 8) {
+        uint64_t bits = wireLoadLE(p, 8);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    uint32_t bits = (uint32_t)wireLoadLE(p, 4);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Build a datagram from count values. Pass timestamp_ns < 0 to omit the
+// base timestamp, interval_ns < 0 to omit the sample interval and sequence
+// < 0 to omit the sequence number. Returns the datagram size, or 0 if it
+// does not fit.
+inline size_t encodeWireSamples(char* buffer, size_t capacity, const double* values, size_t count,
+                                uint16_t channel, bool use_float64, long long timestamp_ns = -1,
+                                long long interval_ns = -1, long long sequence = -1) {
+    uint8_t flags = use_float64 ? WIRE_FLAG_FLOAT64 : 0;
+    size_t offset = WIRE_HEADER_SIZE;
+    if (timestamp_ns >= 0) {
+        flags |= WIRE_FLAG_TIMESTAMP;
+        offset += WIRE_TIMESTAMP_SIZE;
+    }
+    if (interval_ns >= 0) {
+        flags |= WIRE_FLAG_INTERVAL;
+        offset += WIRE_INTERVAL_SIZE;
+    }
+    if (sequence >= 0) {
+        flags |= WIRE_FLAG_SEQUENCE;
+        offset += WIRE_SEQUENCE_SIZE;
+    }
+    
+    size_t sample_size = use_float64 ? 8 : 4;
+    if (count > 0xFFFF || offset + count * sample_size > capacity) {
+        return 0;
+    }
+    
+    memcpy(buffer, WIRE_MAGIC, sizeof(WIRE_MAGIC));
+    buffer[4] = (char)WIRE_VERSION;
+    buffer[5] = (char)flags;
+    wireStoreLE(buffer + 6, channel, 2);
+    wireStoreLE(buffer + 8, count, 2);
+    wireStoreLE(buffer + 10, 0, 2);
+    size_t field = WIRE_HEADER_SIZE;
+    if (timestamp_ns >= 0) {
+        wireStoreLE(buffer + field, (uint64_t)timestamp_ns, WIRE_TIMESTAMP_SIZE);
+        field += WIRE_TIMESTAMP_SIZE;
+    }
+    if (interval_ns >= 0) {
+        wireStoreLE(buffer + field, (uint64_t)interval_ns, WIRE_INTERVAL_SIZE);
+        field += WIRE_INTERVAL_SIZE;
+    }
+    if (sequence >= 0) {
+        wireStoreLE(buffer + field, (uint64_t)sequence, WIRE_SEQUENCE_SIZE);
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        char* p = buffer + offset + i * sample_size;
+        if (use_float64) {
+            uint64_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            wireStoreLE(p, bits, 8);
+        } else {
+            float value = (float)values[i];
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            wireStoreLE(p, bits, 4);
+        }
+    }
+    
+    return offset + count * sample_size;
+}
+
+#endif // WIRE_FORMAT_H